@@ -0,0 +1,19 @@
+/** @file chrono.h
+ *
+ * @brief Wall-clock measurement of durations.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * This module is kept apart because `<time.h>` cannot be included
+ * along with `physics.h`, which defines its own `time_t`.
+ */
+
+#ifndef CHRONO_H
+#define CHRONO_H
+
+/** @brief Read a monotonic wall clock.
+ * @return  current time, in seconds from an arbitrary origin
+ */
+double chrono_now (void);
+
+#endif
@@ -0,0 +1,58 @@
+/** @file domains.h
+ *
+ * @brief Parallel simulation engine, splitting the box into spatial domains.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * The box is split into slabs along the first dimention. Time is advanced
+ * by windows: during a window, each domain (a group of slabs) is run by its
+ * own {@link simulation_t simulation}, on its own thread, over the particles
+ * it owns and copies of the particles of the other domains close to it,
+ * called ghosts. A window is short enough for particles to move by at most
+ * {@link DOMAINS_REACH} times the biggest radius, so that the partner of
+ * every collision of an owned particle is either owned or a ghost.
+ *
+ * Windows are optimistic. Once every domain has reached the end of a window,
+ * each ghost which collided with an owned particle is compared with the
+ * particle it copies, as advanced by its owner domain. If they differ, the
+ * ghost missed an event which only its owner could see: the window is run
+ * again, with both domains merged. If a particle moved too far, the window is
+ * run again, twice shorter. Otherwise, owned particles are copied back to the
+ * store, and the next window is scaled so that particles move up to the reach.
+ *
+ * With {@link simulation_options.domain_processes}, domains are run by worker
+ * processes instead of threads: each window, the particles of a domain are
+ * sent to a worker, and taken back once advanced. Ownership is decided again
+ * from positions at every window, so particles crossing a slab boundary
+ * migrate to their new owner.
+ *
+ * Every particle goes through the same events, predicted from the same
+ * snapshots, as in the serial engine: results are the same, up to the order
+ * of simultaneous events.
+ */
+
+#ifndef DOMAINS_H
+#define DOMAINS_H
+
+#include "simulation.h"
+
+/** @brief Distance a particle may move during a window, relative to the biggest radius. */
+#define DOMAINS_REACH 1
+
+/** @brief Greatest factor by which the windows grow after a window is committed. */
+#define DOMAINS_GROWTH 1.5
+
+/** @brief Run a simulation loop, advancing spatial domains in parallel.
+ *
+ * Same as {@link simulation_loop}, with {@link simulation_options.nb_domains}
+ * slabs, each run by a thread or by a worker process. The epoch is never moved, and callbacks are
+ * given absolute times.
+ * @param particles  store of the particles used in the simulation (at most \f$2^{32}-1\f$)
+ * @param duration  duration of the simulation (use negative time to run backward)
+ * @param callback  callback function (for example a drawing function)
+ * @param callback_rate  time between two callback (use `0` to disable callbacks)
+ * @param options  options of the simulation, with at least two domains
+ */
+void domains_loop (particles_t *particles, time_t duration, void (*callback)(time_t timestamp), time_t callback_rate, simulation_options_t const *options);
+
+#endif
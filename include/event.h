@@ -10,7 +10,9 @@
 #define EVENT_H
 
 #include "particle.h"
+#include "heap.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 /** @brief Enumeration of the different possible event types.
  * @see event get_event_type
@@ -18,7 +20,7 @@
 enum event_type {
     /** @brief Collision between two particles.
      *
-     * `event.particle_a!=NULL` and `event.particle_b!=NULL`
+     * `event.particle_a!=EVENT_NO_PARTICLE` and `event.particle_b!=EVENT_NO_PARTICLE`
      *
      * @see new_event_collide_particle
      */
@@ -26,70 +28,183 @@ enum event_type {
 
     /** @brief Collision of a particle with an hyperplane.
      *
-     * `event.particle_a!=NULL` and `event.particle_b==NULL`
+     * `event.particle_a!=EVENT_NO_PARTICLE` and `event.particle_b==EVENT_NO_PARTICLE`
      *
      * Normal dimention to the hyperplane can be retrieved with `event.particle_b_col`.
      * @see new_event_collide_hplane
      */
     EVENT_COLLIDE_HPLANE,
 
-    /** @brief Refreshing event.
+    /** @brief A particle leaves its cell of the neighbor search grid.
      *
-     * `event.particle_a==NULL` and `event.particle_b==NULL`
+     * `event.particle_a!=EVENT_NO_PARTICLE` and `event.particle_b==EVENT_NO_PARTICLE`
      *
-     * `event.particle_a_col` and `event.particle_b_col` can be ignored.
-     * @see new_event_refresh
+     * Normal dimention to the crossed face can be retrieved with `event.particle_b_col-NB_DIM`.
+     * @see new_event_cross_cell
      */
-    EVENT_REFRESH,
+    EVENT_CROSS_CELL,
 };
 
+/** @brief Index of a particle in the particle list of the simulation. */
+typedef uint32_t particle_id_t;
+
+/** @brief A constant for the absence of particle in an event. */
+#define EVENT_NO_PARTICLE UINT32_MAX
+
+/** @brief An alias to the fixed-width keys ordering the events.
+ *
+ * Keys are built from the timestamps so that comparing two keys as
+ * unsigned integers gives the order of the timestamps.
+ * @see event_key event_timestamp
+ */
+typedef heap_key_t event_key_t;
+
 /** @brief An alias to the structure representing the events. */
 typedef struct event event_t;
 
 /** @brief The structure representing the events.
+ *
+ * Particles are referred to by their index in the particle list of the
+ * simulation, and collision counters are truncated to 32 bits, so that
+ * an event takes 24 bytes. Keys only hold `double` times, so in the
+ * default build the `long double` time of an event is kept by its pool,
+ * next to the event (see {@link EVENT_MEMORY}).
  *
  * Here is how to interprete event :
- * - `event.particle_a==NULL` and `event.particle_b==NULL`: refreshing event ({@link EVENT_REFRESH}).
- * - `event.particle_a!=NULL` and `event.particle_b==NULL`: collision with an hyperplane ({@link EVENT_COLLIDE_HPLANE}).
+ * - `event.particle_a!=EVENT_NO_PARTICLE` and `event.particle_b==EVENT_NO_PARTICLE`: collision with an hyperplane ({@link EVENT_COLLIDE_HPLANE}).
  * Normal dimention to the hyperplane can be retrieved with `event.particle_b_col`.
- * - `event.particle_a!=NULL` and `event.particle_b!=NULL`: collision between two particles ({@link EVENT_COLLIDE_PARTICLE})
+ * - `event.particle_a!=EVENT_NO_PARTICLE`, `event.particle_b==EVENT_NO_PARTICLE` and `event.particle_b_col>=NB_DIM`:
+ * particle leaving its cell ({@link EVENT_CROSS_CELL}).
+ * Normal dimention to the crossed face can be retrieved with `event.particle_b_col-NB_DIM`.
+ * - `event.particle_a!=EVENT_NO_PARTICLE` and `event.particle_b!=EVENT_NO_PARTICLE`: collision between two particles ({@link EVENT_COLLIDE_PARTICLE})
  */
 struct event {
-    /** @brief Absolute time of the event
+    /** @brief Key of the absolute time of the event
+     * @see event_timestamp
      */
-    time_t timestamp;
+    event_key_t key;
 
-    /** @brief Pointer to the first particle involved in the collision
+    /** @brief Index of the first particle involved in the collision
      */
-    particle_t *particle_a;
+    particle_id_t particle_a;
 
-    /** @brief Pointer to the second particle involved in the collision
+    /** @brief Index of the second particle involved in the collision
      */
-    particle_t *particle_b;
+    particle_id_t particle_b;
 
-    /** @brief Number of collision of the first particle when the event was planned.
-     *
-     * Represents orthogonal dimention when particle is `NULL`,
-     * in case of `EVENT_COLLIDE_HPLANE`.
+    /** @brief Number of collision of the first particle when the event was planned, modulo \f$2^{32}\f$.
      */
-    size_t particle_a_col;
+    uint32_t particle_a_col;
 
-    /** @brief Number of collision of the second particle when the event was planned.
+    /** @brief Number of collision of the second particle when the event was planned, modulo \f$2^{32}\f$.
      *
-     * Represents orthogonal dimention when particle is `NULL`,
-     * in case of `EVENT_COLLIDE_HPLANE`.
+     * Represents orthogonal dimention when there is no second particle,
+     * in case of `EVENT_COLLIDE_HPLANE`, and orthogonal dimention plus `NB_DIM`
+     * in case of `EVENT_CROSS_CELL`.
      */
-    size_t particle_b_col;
+    uint32_t particle_b_col;
 
 };
 
+/** @brief Number of bytes used by an event, including the time kept by its pool. */
+#ifndef DOUBLE_PRECISION
+#define EVENT_MEMORY (sizeof(event_t) + sizeof(time_t))
+#else
+#define EVENT_MEMORY sizeof(event_t)
+#endif
+
+/** @brief An alias to the structure representing a pool of events. */
+typedef struct event_pool event_pool_t;
+
+/** @brief The structure representing a pool of events.
+ *
+ * Events are carved out of big chunks of memory, and released events are
+ * kept in a free list to be recycled by the next allocations. Chunks are
+ * only given back to the system when the whole pool is deallocated.
+ * A chunk also holds the precise times of its events, and is aligned so
+ * that it can be found from the address of any of its events.
+ */
+struct event_pool;
+
+/** @brief An alias to the structure representing the counters of a pool of events. */
+typedef struct event_pool_stats event_pool_stats_t;
+
+/** @brief The structure representing the counters of a pool of events. */
+struct event_pool_stats {
+    /** @brief Number of events allocated from the pool. */
+    size_t nb_allocations;
+
+    /** @brief Number of allocations served by recycling a released event. */
+    size_t nb_recycled;
+
+    /** @brief Number of events currently allocated. */
+    size_t nb_live;
+
+    /** @brief Maximal number of events allocated at the same time. */
+    size_t max_live;
+
+    /** @brief Number of bytes reserved from the system. */
+    size_t memory;
+};
+
+/** @brief Create an empty pool of events.
+ * @return  the pool, which was allocated
+ */
+event_pool_t *event_pool_new (void);
+
+/** @brief Get the counters of a pool of events.
+ * @param pool  the pool
+ * @return  the current counters of the pool
+ */
+event_pool_stats_t event_pool_stats (event_pool_t const *pool);
+
+/** @brief Deallocate a pool and every event allocated from it.
+ * @param pool  the pool
+ */
+void event_pool_deallocate (event_pool_t *pool);
+
+/** @brief Release an event, so that it can be recycled.
+ * @param pool  the pool from which the event was allocated
+ * @param e  the event to release, ignored if `NULL`
+ */
+void event_release (event_pool_t *pool, event_t *e);
+
+/** @brief Get the key of a timestamp.
+ *
+ * The timestamp is rounded to a `double`.
+ * @param timestamp  absolute time
+ * @return  the key, ordered as the timestamps
+ */
+event_key_t event_key (time_t timestamp);
+
+/** @brief Get the absolute time of an event.
+ *
+ * Events are processed at this time, while their key only orders them.
+ * @param e  the event
+ * @return  the timestamp from which the key of the event was built,
+ *          not rounded to a `double`
+ */
+time_t event_timestamp (event_t const *e);
+
+/** @brief Move an event earlier, for instance when the origin of time moves.
+ * @param e  the event, whose key changes
+ * @param shift  time by which the event is moved earlier
+ */
+void event_shift (event_t *e, time_t shift);
+
 /** @brief Determine if an event is still valid.
  * @param e  event to be tested
+ * @param ps  store of the particles of the simulation
  * @return  `true` if the event is currently valid
  */
-bool event_is_valid (event_t *e);
+bool event_is_valid (event_t const *e, particles_t const *ps);
 
 /** @brief Compare two events.
+ *
+ * Events of equal keys are compared by their {@link event_timestamp timestamps},
+ * so that they are processed in order even when their keys round them.
+ * Events can be compared faster by comparing their keys directly, and by
+ * breaking ties of keys only with this function.
  * @param event1  the first event to compare
  * @param event2  the second event to compare
  * @return  -1,0,1 if the first event is respectively lower, equal, greater
@@ -102,29 +217,36 @@ int compare_events (void *event1, void *event2);
  * @param e  event to be tested
  * @return  event type
  */
-enum event_type get_event_type (event_t *e);
+enum event_type get_event_type (event_t const *e);
 
 /** @brief Create a new {@link EVENT_COLLIDE_PARTICLE particle collision event}.
+ * @param pool  the pool from which to allocate the event
  * @param timestamp  absolute time of the event
- * @param p1  first particle involved in the collision
- * @param p2  second particle involved in the collision
+ * @param ps  store of the particles
+ * @param a  index of the first particle involved in the collision
+ * @param b  index of the second particle involved in the collision
  * @return  the event, which was allocated
  */
-event_t *event_collide_particle (time_t timestamp, particle_t *p1, particle_t *p2);
+event_t *event_collide_particle (event_pool_t *pool, time_t timestamp, particles_t const *ps, size_t a, size_t b);
 
 /** @brief Create a new {@link EVENT_COLLIDE_HPLANE hplane collision event}.
+ * @param pool  the pool from which to allocate the event
  * @param timestamp  absolute time of the event
- * @param p1  the particle involved in the collision
+ * @param ps  store of the particles
+ * @param a  index of the particle involved in the collision
  * @param dim  dimention orthogonal to the hyperplane
  * @return  the event, which was allocated
  */
-event_t *event_collide_hplane (time_t timestamp, particle_t *p, size_t dim);
+event_t *event_collide_hplane (event_pool_t *pool, time_t timestamp, particles_t const *ps, size_t a, size_t dim);
 
-/** @brief Create a new {@link EVENT_REFRESH refresh event}.
+/** @brief Create a new {@link EVENT_CROSS_CELL cell crossing event}.
+ * @param pool  the pool from which to allocate the event
  * @param timestamp  absolute time of the event
- * @param result  the refresh event, modified in place
+ * @param ps  store of the particles
+ * @param a  index of the particle leaving its cell
+ * @param dim  dimention orthogonal to the crossed face
  * @return  the event, which was allocated
  */
-event_t *event_refresh (time_t timestamp);
+event_t *event_cross_cell (event_pool_t *pool, time_t timestamp, particles_t const *ps, size_t a, size_t dim);
 
 #endif
@@ -0,0 +1,98 @@
+/** @file grid.h
+ *
+ * @brief Uniform grid of cells covering the unit box, used to find neighbor particles.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * The box `[0,loc_UNIT]^NB_DIM` is split into cubic cells whose width is
+ * at least the diameter of the biggest particle. Each particle is registered
+ * in the cell containing its center, so two particles can only touch each
+ * other if their cells are adjacent (or identical).
+ *
+ * Particles are identified by their index. A particle only changes of cell
+ * by crossing one of the faces of its cell, see {@link grid_move}.
+ */
+
+#ifndef GRID_H
+#define GRID_H
+
+#include "physics.h"
+#include <stddef.h>
+
+/** @brief An alias to the structure representing a grid. */
+typedef struct grid grid_t;
+
+/** @brief The structure representing a grid. */
+struct grid;
+
+
+
+/** @brief Create an empty grid.
+ * @param nb_part  number of particles which can be registered
+ * @param min_width  minimal width of a cell
+ * @return  a new grid, with no particle registered
+ */
+grid_t *grid_new (size_t nb_part, loc_t min_width);
+
+/** @brief Register a particle in the cell containing a position.
+ *
+ * Positions outside of the box are registered in the closest cell.
+ * @param g  the grid
+ * @param i  index of the particle
+ * @param position  position of the particle
+ */
+void grid_insert (grid_t *g, size_t i, loc_t const position[NB_DIM]);
+
+/** @brief Unregister a particle, which may then be registered again.
+ * @param g  the grid
+ * @param i  index of the particle
+ */
+void grid_remove (grid_t *g, size_t i);
+
+/** @brief Move a particle to an adjacent cell.
+ * @param g  the grid
+ * @param i  index of the particle
+ * @param dim  dimention orthogonal to the crossed face
+ * @param dir  `1` to move toward higher coordinates, `-1` else
+ */
+void grid_move (grid_t *g, size_t i, size_t dim, int dir);
+
+/** @brief Get the position of a face of the cell of a particle.
+ * @param g  the grid
+ * @param i  index of the particle
+ * @param dim  dimention orthogonal to the face
+ * @param dir  `1` for the face with higher coordinates, `-1` else
+ * @return  position of the face along the `dim` axis, or `NEVER` if the face is
+ *          a wall of the box (the particle cannot cross it)
+ */
+loc_t grid_face (grid_t const *g, size_t i, size_t dim, int dir);
+
+/** @brief Get the particles registered in the cell of a particle and in the adjacent cells.
+ *
+ * The particle itself is part of the result.
+ * @param g  the grid
+ * @param i  index of the particle
+ * @param count  filled with the number of neighbors
+ * @return  the indexes of the neighbors, valid until the next call on `g`
+ */
+size_t const *grid_neighbors (grid_t *g, size_t i, size_t *count);
+
+/** @brief Get the particles registered in the cells which just became adjacent.
+ *
+ * After a particle moved along `dim` in direction `dir`, the cells beyond
+ * its new cell in that direction became adjacent.
+ * @param g  the grid
+ * @param i  index of the particle
+ * @param dim  dimention along which the particle moved
+ * @param dir  direction in which the particle moved
+ * @param count  filled with the number of neighbors
+ * @return  the indexes of the neighbors, valid until the next call on `g`
+ */
+size_t const *grid_new_neighbors (grid_t *g, size_t i, size_t dim, int dir, size_t *count);
+
+/** @brief Deallocate the grid.
+ * @param g  the grid
+ */
+void grid_deallocate (grid_t *g);
+
+#endif
@@ -6,16 +6,29 @@
  *
  * This heap does not handle NULL values.
  *
+ * Values are stored in a contiguous array used as an implicit tree
+ * (children of cell `i` are cells `2i+1` and `2i+2`), which grows and
+ * shrinks by doubling/halving so that resizing is amortized.
+ *
+ * Values are ordered either by a comparator function, or by an unsigned
+ * integer key embedded in each value: a keyed heap copies the keys next
+ * to the values, so that ordering never has to read the values nor to
+ * call a function.
+ *
  * Inserting a value and extracting the minimum value are guaranteed
- * to have a worst-case complexity in $O(\log n)$ where $n$ is the
+ * to have an amortized complexity in $O(\log n)$ where $n$ is the
  * size of the heap.
  *
  * The API of the binary heap is defined as follows:
  *
  * - a function to create an empty heap
+ * - a function to create an empty keyed heap
  * - a function to check if the heap is empty
+ * - a function to get the size of the heap
  * - a function to insert a new value in the heap
+ * - a function to insert many values in the heap
  * - a function to get the minimum value in the heap
+ * - a function to remove the values failing a predicate
  * - a function to deallocate the binary heap
  */
 
@@ -23,6 +36,8 @@
 #define HEAP_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /** @brief An alias to the structure representing a binary heap. */
 typedef struct heap heap_t;
@@ -37,10 +52,23 @@ typedef struct heap heap_t;
  */
 typedef int (*compare_func_t)(void *v1, void *v2);
 
+/** @brief An alias to the keys of a keyed heap.
+ *
+ * Lower keys are extracted first.
+ */
+typedef uint64_t heap_key_t;
+
 /** @brief An alias to operation functions.
  */
 typedef void (*operate_func_t)(void *v);
 
+/** @brief An alias to filter functions.
+ *
+ * Filter functions take a value and the data given along with the filter,
+ * and return `true` if the value is to be kept.
+ */
+typedef bool (*filter_func_t)(void *v, void *data);
+
 /** @brief The structure representing the binary heap. */
 struct heap;
 
@@ -60,6 +88,26 @@ struct heap;
  */
 heap_t *heap_new (compare_func_t comparator, operate_func_t deallocate_value);
 
+/**
+ * @brief Create a nil keyed binary heap.
+ *
+ * Every value holds a {@link heap_key_t key} at offset `key_offset`, which
+ * must not change while the value is in the heap, except within
+ * {@link heap_filter}.
+ *
+ * @param key_offset  the offset of the key inside the values,
+ *                    as given by `offsetof`
+ *
+ * @param tie  the comparator ordering values of equal keys, only called
+ *             on such values - use `NULL` if not needed
+ *
+ * @param deallocate_value  the function charged to deallocate values -
+ *                          use `NULL`if not needed
+ *
+ * @return  a new empty binary heap
+ */
+heap_t *heap_new_keyed (size_t key_offset, compare_func_t tie, operate_func_t deallocate_value);
+
 /**
  * @brief Is the binary heap empty?
  *
@@ -72,6 +120,17 @@ heap_t *heap_new (compare_func_t comparator, operate_func_t deallocate_value);
  */
 bool heap_is_empty (heap_t const *p_heap);
 
+/**
+ * @brief Get the number of values in the binary heap.
+ *
+ * @param p_heap  a pointer to the heap
+ *
+ * @return  the number of values in `p_heap`
+ *
+ * @pre  `p_heap` is not `NULL`
+ */
+size_t heap_size (heap_t const *p_heap);
+
 /**
  * @brief Insert a new value in the binary heap.
  *
@@ -93,6 +152,25 @@ bool heap_is_empty (heap_t const *p_heap);
  */
 void heap_insert (heap_t *p_heap, void *value);
 
+/**
+ * @brief Insert many values in the binary heap at once.
+ *
+ * `NULL` values are ignored.
+ *
+ * When at least as many values are inserted as the heap already holds,
+ * the whole heap is rebuilt bottom-up, so the execution time is in
+ * \f$O(n+k)\f$ where \f$n\f$ is the size of the binary heap and \f$k\f$ the
+ * number of inserted values. Otherwise, values are inserted one by one.
+ *
+ * @param p_heap  a pointer to the heap in which the values are
+ *                to be inserted
+ * @param values  the values to be inserted
+ * @param count   the number of values
+ *
+ * @pre  `p_heap` is not `NULL`
+ */
+void heap_insert_bulk (heap_t *p_heap, void *values[], size_t count);
+
 /** @brief Extract the minimum value in the binary heap.
  *
  * The worst-case execution time of this function
@@ -108,13 +186,31 @@ void heap_insert (heap_t *p_heap, void *value);
  */
 void *heap_extract_min (heap_t *p_heap);
 
+/** @brief Remove every value failing a predicate from the binary heap.
+ *
+ * Removed values are not deallocated: `keep` may deallocate the values
+ * it rejects. `keep` may also change the keys of the values it keeps,
+ * which are read again. The heap is then rebuilt bottom-up, and shrunk if
+ * it holds few values, so the execution time is in \f$O(n)\f$ where \f$n\f$
+ * is the size of the binary heap.
+ *
+ * @param p_heap  a pointer to the heap to be filtered
+ * @param keep    the predicate, called once on every value
+ * @param data    data given to every call of `keep`
+ *
+ * @return  the number of removed values
+ *
+ * @pre  `p_heap` is not `NULL`
+ */
+size_t heap_filter (heap_t *p_heap, filter_func_t keep, void *data);
+
 /** @brief Deallocate the binary heap and free the pointer.
  *
  * @param p_heap  a pointer to the binary heap to be deallocated
  *
  * @pre  `p_heap` is not `NULL`
  *
- * @post  After the call, all memory regions used for the nodes
+ * @post  After the call, all memory regions used for the values array
  *        are deallocated. Values are also deallocated.
  */
 void heap_deallocate (heap_t *p_heap);
@@ -0,0 +1,100 @@
+/** @file hgrid.h
+ *
+ * @brief Hierarchical grid of cells covering the unit box, used to find neighbor particles.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * The box `[0,loc_UNIT]^NB_DIM` is split into several uniform grids, called
+ * levels, whose cells are at least twice wider from a level to the next one.
+ * Each particle is registered at the finest level whose cells are at least
+ * as wide as its diameter, in the cell containing its center: small
+ * particles get small cells, whatever the size of the biggest particle.
+ *
+ * The neighbors of a particle are searched at every level holding
+ * particles, in the cells close enough to its cell for the biggest particles
+ * of that level to touch it: the adjacent cells at its own level, a few more
+ * cells at finer levels, and at most the adjacent cells at coarser levels.
+ *
+ * Particles are identified by their index. A particle only changes of cell
+ * by crossing one of the faces of its cell, see {@link hgrid_move}.
+ */
+
+#ifndef HGRID_H
+#define HGRID_H
+
+#include "physics.h"
+#include <stddef.h>
+
+/** @brief An alias to the structure representing a hierarchical grid. */
+typedef struct hgrid hgrid_t;
+
+/** @brief The structure representing a hierarchical grid. */
+struct hgrid;
+
+
+
+/** @brief Create an empty hierarchical grid.
+ * @param nb_part  number of particles which can be registered
+ * @param min_width  minimal width of a cell of the finest level
+ * @param max_width  minimal width of a cell of the coarsest level
+ * @return  a new hierarchical grid, with no particle registered
+ */
+hgrid_t *hgrid_new (size_t nb_part, loc_t min_width, loc_t max_width);
+
+/** @brief Register a particle in the cell containing a position, at the level matching its size.
+ *
+ * Positions outside of the box are registered in the closest cell.
+ * @param g  the hierarchical grid
+ * @param i  index of the particle
+ * @param position  position of the particle
+ * @param radius  radius of the particle
+ */
+void hgrid_insert (hgrid_t *g, size_t i, loc_t const position[NB_DIM], loc_t radius);
+
+/** @brief Move a particle to an adjacent cell of its level.
+ * @param g  the hierarchical grid
+ * @param i  index of the particle
+ * @param dim  dimention orthogonal to the crossed face
+ * @param dir  `1` to move toward higher coordinates, `-1` else
+ */
+void hgrid_move (hgrid_t *g, size_t i, size_t dim, int dir);
+
+/** @brief Get the position of a face of the cell of a particle.
+ * @param g  the hierarchical grid
+ * @param i  index of the particle
+ * @param dim  dimention orthogonal to the face
+ * @param dir  `1` for the face with higher coordinates, `-1` else
+ * @return  position of the face along the `dim` axis, or `NEVER` if the face is
+ *          a wall of the box (the particle cannot cross it)
+ */
+loc_t hgrid_face (hgrid_t const *g, size_t i, size_t dim, int dir);
+
+/** @brief Get the particles registered in the cells close to the cell of a particle, at every level.
+ *
+ * The particle itself is part of the result.
+ * @param g  the hierarchical grid
+ * @param i  index of the particle
+ * @param count  filled with the number of neighbors
+ * @return  the indexes of the neighbors, valid until the next call on `g`
+ */
+size_t const *hgrid_neighbors (hgrid_t *g, size_t i, size_t *count);
+
+/** @brief Get the particles registered in the cells which just became close.
+ *
+ * After a particle moved along `dim` in direction `dir`, some cells beyond
+ * its new cell in that direction became close, at every level.
+ * @param g  the hierarchical grid
+ * @param i  index of the particle
+ * @param dim  dimention along which the particle moved
+ * @param dir  direction in which the particle moved
+ * @param count  filled with the number of neighbors
+ * @return  the indexes of the neighbors, valid until the next call on `g`
+ */
+size_t const *hgrid_new_neighbors (hgrid_t *g, size_t i, size_t dim, int dir, size_t *count);
+
+/** @brief Deallocate the hierarchical grid.
+ * @param g  the hierarchical grid
+ */
+void hgrid_deallocate (hgrid_t *g);
+
+#endif
@@ -0,0 +1,31 @@
+/** @file mapping.h
+ *
+ * @brief Memory mapping of whole files.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * This module is kept apart because `<sys/mman.h>` cannot be included
+ * along with `physics.h`, which defines its own `time_t`.
+ */
+
+#ifndef MAPPING_H
+#define MAPPING_H
+
+#include <stddef.h>
+
+/** @brief Map a whole file in memory.
+ *
+ * The mapping is private: it can be written to, without changing the file.
+ * @param path  path of the file
+ * @param size  filled with the size of the file
+ * @return  the address of the mapping, or `NULL` if the file cannot be mapped
+ */
+void *mapping_open (char const *path, size_t *size);
+
+/** @brief Unmap a file mapped by {@link mapping_open}.
+ * @param address  the address of the mapping
+ * @param size  the size of the file
+ */
+void mapping_close (void *address, size_t size);
+
+#endif
@@ -0,0 +1,136 @@
+/** @file neighbors.h
+ *
+ * @brief Search of the particles which may collide with a given particle.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * The available implementations are:
+ * - {@link NEIGHBORS_ALL}: every particle is a candidate.
+ * - {@link NEIGHBORS_GRID}: only the particles of the same or adjacent cells
+ *   of a {@link grid.h uniform grid} are candidates. Particles must be moved
+ *   from cell to cell when they cross a face, see
+ *   {@link neighbors_time_before_crossing} and {@link neighbors_cross}.
+ * - {@link NEIGHBORS_SWEEP}: only the particles whose {@link sweep.h bounding box}
+ *   overlaps the box of the particle are candidates. Boxes move when particles
+ *   reach their faces, like particles moving from cell to cell.
+ * - {@link NEIGHBORS_HGRID}: like {@link NEIGHBORS_GRID}, but each particle is
+ *   registered in a {@link hgrid.h hierarchical grid} at the level matching its size.
+ */
+
+#ifndef NEIGHBORS_H
+#define NEIGHBORS_H
+
+#include "particle.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @brief Enumeration of the different neighbor search implementations.
+ * @see neighbors_new
+ */
+enum neighbors_type {
+    /** @brief Every particle is a neighbor of every other particle. */
+    NEIGHBORS_ALL,
+
+    /** @brief Uniform grid, neighbors are in the same or adjacent cells. */
+    NEIGHBORS_GRID,
+
+    /** @brief Sweep and prune, neighbors have overlapping bounding boxes.
+     *
+     * Unlike the cells of the grid, boxes are as small as their particles,
+     * which suits particles of very different sizes.
+     */
+    NEIGHBORS_SWEEP,
+
+    /** @brief Hierarchical grid, neighbors are in close cells of every level.
+     *
+     * Small particles are registered in small cells and big particles in
+     * big cells, which suits particles of very different sizes.
+     */
+    NEIGHBORS_HGRID,
+};
+
+/** @brief An alias to the structure representing a neighbor search. */
+typedef struct neighbors neighbors_t;
+
+/** @brief The structure representing a neighbor search. */
+struct neighbors;
+
+
+
+/** @brief Get a neighbor search implementation from its name.
+ * @param name  name of the implementation (`"all"`, `"grid"`, `"sweep"` or `"hgrid"`)
+ * @param type  filled with the implementation
+ * @return  `true` if the name is known
+ */
+bool neighbors_type_parse (char const *name, enum neighbors_type *type);
+
+/** @brief Get the name of a neighbor search implementation.
+ * @param type  the implementation
+ * @return  the name of the implementation
+ */
+char const *neighbors_type_name (enum neighbors_type type);
+
+/** @brief Create a neighbor search over a store of particles.
+ *
+ * The particles are registered according to their position at a given time,
+ * so that no face of their cell is crossed before it, and room is made for
+ * the capacity of the store, see {@link neighbors_insert}.
+ * The store must outlive the neighbor search.
+ * @param type  the implementation to use
+ * @param ps  store of the particles
+ * @param timestamp  time at which the particles are registered, not older than their snapshots
+ * @return  a new neighbor search
+ */
+neighbors_t *neighbors_new (enum neighbors_type type, particles_t const *ps, time_t timestamp);
+
+/** @brief Register a particle added to the store after the neighbor search was created.
+ *
+ * The particle is registered according to its snapshot position, and must
+ * have the next index. It does not fit if the store has grown beyond the
+ * capacity it had at creation, or if the particle is bigger than the ones
+ * the structures were sized for: the neighbor search must then be created again.
+ * @param n  the neighbor search
+ * @param i  index of the particle
+ * @return  `true` if the particle was registered, `false` if it does not fit
+ */
+bool neighbors_insert (neighbors_t *n, size_t i);
+
+/** @brief Get the candidates for a collision with a particle.
+ *
+ * The particle itself may be part of the result.
+ * @param n  the neighbor search
+ * @param i  index of the particle
+ * @param count  filled with the number of candidates
+ * @return  the indexes of the candidates, valid until the next call on `n`
+ */
+size_t const *neighbors_of (neighbors_t *n, size_t i, size_t *count);
+
+/** @brief Compute the time before a particle leaves its cell, or the margin of its box.
+ * @param n  the neighbor search
+ * @param i  index of the particle
+ * @param time_flow  direction of time (`1` or `-1`)
+ * @param dim  filled with the dimention orthogonal to the crossed face
+ * @return  relative time before crossing (multiplied by `time_flow`),
+ *          or `NEVER` if the particle never leaves its cell
+ */
+time_t neighbors_time_before_crossing (neighbors_t const *n, size_t i, int time_flow, size_t *dim);
+
+/** @brief Move a particle to the next cell, or move its box.
+ *
+ * The particle is assumed to be on the crossed face, moving in the direction given by its velocity.
+ * @param n  the neighbor search
+ * @param i  index of the particle
+ * @param dim  dimention orthogonal to the crossed face
+ * @param time_flow  direction of time (`1` or `-1`)
+ * @param count  filled with the number of new candidates
+ * @return  the indexes of the particles which just became candidates,
+ *          valid until the next call on `n`
+ */
+size_t const *neighbors_cross (neighbors_t *n, size_t i, size_t dim, int time_flow, size_t *count);
+
+/** @brief Deallocate the neighbor search.
+ * @param n  the neighbor search
+ */
+void neighbors_deallocate (neighbors_t *n);
+
+#endif
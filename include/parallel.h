@@ -0,0 +1,93 @@
+/** @file parallel.h
+ *
+ * @brief Threads running the same function on parts of a work.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * Threads are either started for a single run, by {@link parallel_run}, or
+ * kept waiting in a {@link parallel_pool_t pool} between runs, for works too
+ * short to pay for starting threads. Tasks of unknown lengths are shared by
+ * {@link parallel_steal}.
+ *
+ * This module is kept apart because `<pthread.h>` cannot be included
+ * along with `physics.h`, which defines its own `time_t`.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+/** @brief A function run by each thread.
+ * @param data  the data shared by every thread
+ * @param thread  index of the thread, from `0` to the number of threads excluded
+ */
+typedef void (*parallel_func_t)(void *data, size_t thread);
+
+/** @brief Get the number of processors available.
+ * @return  the number of online processors, at least `1`
+ */
+size_t parallel_nb_cpus (void);
+
+/** @brief Run a function on several threads, and wait for all of them.
+ *
+ * The calling thread runs the function as thread `0`.
+ * @param nb_threads  number of threads
+ * @param func  function run by each thread
+ * @param data  data given to every thread
+ */
+void parallel_run (size_t nb_threads, parallel_func_t func, void *data);
+
+/** @brief A task run by {@link parallel_steal}.
+ * @param data  the data shared by every task
+ * @param task  index of the task
+ */
+typedef void (*parallel_task_t)(void *data, size_t task);
+
+/** @brief Run many tasks on several threads, balanced by work stealing.
+ *
+ * Each thread starts with a contiguous share of the tasks, and runs them in
+ * order. Once its share is done, it steals the last half of the tasks left to
+ * another thread, until none is left. The calling thread is one of them.
+ * @param nb_threads  number of threads
+ * @param nb_tasks  number of tasks
+ * @param func  function running a task
+ * @param data  data given to every task
+ */
+void parallel_steal (size_t nb_threads, size_t nb_tasks, parallel_task_t func, void *data);
+
+/** @brief An alias to the structure representing a pool of waiting threads. */
+typedef struct parallel_pool parallel_pool_t;
+
+/** @brief The structure representing a pool of waiting threads. */
+struct parallel_pool;
+
+/** @brief Start the threads of a pool.
+ *
+ * The calling thread counts as one of them: it runs its part of every work.
+ * @param nb_threads  number of threads, including the calling one
+ * @return  a new pool, with fewer threads if some cannot be started
+ */
+parallel_pool_t *parallel_pool_new (size_t nb_threads);
+
+/** @brief Get the number of threads of a pool.
+ * @param pool  the pool
+ * @return  the number of threads running each work, including the calling one
+ */
+size_t parallel_pool_size (parallel_pool_t const *pool);
+
+/** @brief Run a function on every thread of a pool, and wait for all of them.
+ *
+ * The calling thread runs the function as thread `0`.
+ * @param pool  the pool
+ * @param func  function run by each thread
+ * @param data  data given to every thread
+ */
+void parallel_pool_run (parallel_pool_t *pool, parallel_func_t func, void *data);
+
+/** @brief Stop the threads of a pool and free it.
+ * @param pool  the pool
+ */
+void parallel_pool_deallocate (parallel_pool_t *pool);
+
+#endif
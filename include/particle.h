@@ -1,15 +1,22 @@
 /** @file particle.h
  *
- * @brief Simple definition of a particle.
+ * @brief Simple definition of a particle, and of a store of particles.
  *
  * @author Jean-Raphaël GAGLIONE
  *
+ * A {@link particle_t particle} describes a single particle, as read from
+ * or written to files. The simulation works on a {@link particles_t store}
+ * of particles, which keeps each field of every particle in its own
+ * contiguous array, so that particles are accessed by their index and
+ * scans over a field stream through memory.
+ *
  */
 
 #ifndef PARTICLE_H
 #define PARTICLE_H
 
 #include "physics.h"
+#include <stdbool.h>
 
 /** @brief An alias to the structure representing the particles. */
 typedef struct particle particle_t;
@@ -70,13 +77,123 @@ struct particle {
 
 
 
+/** @brief An alias to the structure representing a store of particles. */
+typedef struct particles particles_t;
+
+/** @brief The structure representing a store of particles.
+ *
+ * The fields of the particle of index `i` are the `i`-th cells of the
+ * arrays, see {@link particle} for their meaning.
+ */
+struct particles {
+    /** @brief Number of particles in the store. */
+    size_t count;
+
+    /** @brief Number of particles the arrays can hold. */
+    size_t capacity;
+
+    /** @brief Collision counter of each particle. */
+    size_t *col_counter;
+
+    /** @brief Absolute time of the snapshot of each particle. */
+    time_t *timestamp;
+
+    /** @brief Position of each particle at snapshot time, one array per dimention. */
+    loc_t *position[NB_DIM];
+
+    /** @brief Velocity of each particle at snapshot time, one array per dimention. */
+    loc_t *velocity[NB_DIM];
+
+    /** @brief Mass of each particle. */
+    mass_t *mass;
+
+    /** @brief Radius of each particle. */
+    loc_t *radius;
+
+    /** @brief File mapped in memory holding the arrays, or `NULL` if they were allocated.
+     *
+     * See {@link snapshot_load}.
+     */
+    void *mapping;
+
+    /** @brief Size of the file mapped in memory. */
+    size_t mapping_size;
+};
+
+
+
+/** @brief Create an empty store of particles.
+ * @param capacity  number of particles the store can hold before growing - may be `0`
+ * @return  the store, which was allocated
+ */
+particles_t *particles_new (size_t capacity);
+
+/** @brief Copy a store of particles.
+ * @param ps  the store to copy
+ * @return  a new store holding the same particles, with the same capacity
+ */
+particles_t *particles_clone (particles_t const *ps);
+
+/** @brief Get the memory used by the arrays of a store.
+ * @param capacity  number of particles the store can hold
+ * @return  the size of the arrays, in bytes
+ */
+size_t particles_memory (size_t capacity);
+
+/** @brief Grow a store so that it can hold a number of particles without reallocation.
+ *
+ * The arrays of a store mapped from a file are copied to memory.
+ * @param ps  the store
+ * @param capacity  number of particles the store must be able to hold
+ * @return  `false` if the memory could not be allocated (the store is then left as it was)
+ */
+bool particles_reserve (particles_t *ps, size_t capacity);
+
+/** @brief Deallocate a store of particles.
+ * @param ps  the store
+ */
+void particles_deallocate (particles_t *ps);
+
+/** @brief Append a particle to a store.
+ *
+ * The store grows if it is full.
+ * @param ps  the store
+ * @param p  the particle to append
+ * @return  the index of the particle in the store
+ */
+size_t particles_add (particles_t *ps, particle_t const *p);
+
+/** @brief Get a copy of a particle of a store.
+ * @param ps  the store
+ * @param i  index of the particle
+ * @return  the particle
+ */
+particle_t particles_get (particles_t const *ps, size_t i);
+
+/** @brief Replace a particle of a store.
+ * @param ps  the store
+ * @param i  index of the particle
+ * @param p  the new description of the particle
+ */
+void particles_set (particles_t *ps, size_t i, particle_t const *p);
+
+/** @brief Compute the position of a particle at a given time, without changing its snapshot.
+ * @param ps  the store
+ * @param i  index of the particle
+ * @param timestamp  absolute timestamp
+ * @param position  filled with the position of the particle
+ */
+void particles_position_at (particles_t const *ps, size_t i, time_t timestamp, loc_t position[NB_DIM]);
+
+
 /** @brief Update the particle position at a new timestamp.
  *
  * The particle position and velocity are set to their values at snapshot `timestamp`.
- * @param p  particle concerned
+ * @param ps  store of the particle
+ * @param i  index of the particle concerned
  * @param timestamp  absolute timestamp
  */
-void update (particle_t *p, time_t timestamp);
+void update (particles_t *ps, size_t i, time_t timestamp);
 
 
 /** @brief Compute the time before the the paticle touches the given hyperplane.
@@ -84,12 +201,13 @@ void update (particle_t *p, time_t timestamp);
  * In 2D, hyperplanes are lines:
  * - for collisions with vertical line, use `dim=0`
  * - for collisions with horizontal line, use `dim=1`
- * @param p  particle concerned
+ * @param ps  store of the particle
+ * @param i  index of the particle concerned
  * @param dim  dimention orthogonal to the hyperplane
  * @param pos  position of that plane along the given dimention axis
  * @return  relative time before crossing
  */
-time_t time_before_crossing_hplane (particle_t const *p, size_t dim, loc_t pos);
+time_t time_before_crossing_hplane (particles_t const *ps, size_t i, size_t dim, loc_t pos);
 
 /** @brief Update the particle location after a collision with the given hyperplane.
  *
@@ -98,10 +216,11 @@ time_t time_before_crossing_hplane (particle_t const *p, size_t dim, loc_t pos);
  * In 2D, hyperplanes are lines:
  * - for collisions with vertical line, use `dim=0`
  * - for collisions with horizontal line, use `dim=1`
- * @param p  particle concerned
+ * @param ps  store of the particle
+ * @param i  index of the particle concerned
  * @param dim  dimention orthogonal to the hyperplane
  */
-void collide_hplane (particle_t *p, size_t dim);
+void collide_hplane (particles_t *ps, size_t i, size_t dim);
 
 
 /** @brief Compute the time at which two particles touch each other.
@@ -109,20 +228,48 @@ void collide_hplane (particle_t *p, size_t dim);
  * The returned time can be lower than the `timestamp` times, meaning that
  * the collision is a passed event.
  *
- * @param p1  first particle concerned
- * @param p2  second particle concerned
- * @return  relative time of the collision, regarding the timestamp of `p1`
+ * @param ps  store of the particles
+ * @param i  index of the first particle concerned
+ * @param j  index of the second particle concerned
+ * @return  relative time of the collision, regarding the timestamp of particle `i`
+ */
+time_t time_before_contact (particles_t const *ps, size_t i, size_t j);
+
+/** @brief Compute the future contacts between a particle and many candidates.
+ *
+ * For each pair, the most recent snapshot is used as reference, as the
+ * trajectory of the other particle is only known from that time. Pairs
+ * which are moving apart in the direction of time are rejected before
+ * solving for the contact time, and so is the particle itself if it is
+ * one of the candidates.
+ *
+ * Candidates are processed by blocks: the relative positions and
+ * velocities of a block are gathered in contiguous arrays, so that their
+ * products are computed by tight loops the compiler can vectorize, and the
+ * square root is only taken for the pairs which survived the rejection.
+ * A contact time equals the one given by {@link time_before_contact}
+ * (multiplied by `time_flow`, plus the reference timestamp) to the bit.
+ *
+ * @param ps  store of the particles
+ * @param i  index of the particle concerned
+ * @param candidates  indexes of the candidates
+ * @param count  number of candidates
+ * @param time_flow  direction of time (`1` or `-1`)
+ * @param hits  filled with the indexes of the candidates which will touch particle `i`
+ * @param times  filled with the absolute times of those contacts, multiplied by `time_flow`
+ * @return  number of contacts found, at most `count`
  */
-time_t time_before_contact (particle_t const *p1, particle_t const *p2);
+size_t time_before_contacts (particles_t const *ps, size_t i, size_t const candidates[], size_t count, int time_flow, size_t hits[], time_t times[]);
 
 /** @brief Update the particles location after a collision between them.
  *
  * The two particles are assumed to have the same `timestamp` time, and
  * the collision is assumed to occur at that time.
  *
- * @param p1  first particle concerned
- * @param p2  second particle concerned
+ * @param ps  store of the particles
+ * @param i  index of the first particle concerned
+ * @param j  index of the second particle concerned
  */
-void collide_particle (particle_t *p1, particle_t *p2);
+void collide_particle (particles_t *ps, size_t i, size_t j);
 
 #endif
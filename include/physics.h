@@ -6,6 +6,9 @@
  *
  * Vectors are represented as `loc_t[NB_DIM]`
  *
+ * Times and locations are `long double` by default. Define `DOUBLE_PRECISION`
+ * (`make DOUBLE=1`) to use `double` instead.
+ *
  */
 
 #ifndef PHYSICS_H
@@ -26,6 +29,37 @@
  */
 #define EPS(type,unit,eps) ((type)((unit)*(eps)))
 
+#ifdef DOUBLE_PRECISION
+/* Times and locations are stored as `double`: half the memory, and
+ * arithmetic which can be vectorized, at the cost of precision. */
+
+/** @brief An alias to the type used for times. */
+typedef double time_t;
+/** @brief The printing format relative to the time type. */
+#define time_F "lf"
+/** @brief A constant for the temporal unit. */
+#define time_UNIT 1.0
+#ifndef time_EPS
+/** @brief A constant for the temporal epsilon value, relative to the unit. */
+#define time_EPS 1e-12
+#endif
+
+/** @brief An alias to the type used for spatial locations. */
+typedef double loc_t;
+/** @brief The printing format relative to the location type. */
+#define loc_F "lf"
+/** @brief The number of significant digits printing a location without loss. */
+#define loc_DIG 17
+/** @brief A constant for the spatial unit. */
+#define loc_UNIT 1.0
+#ifndef loc_EPS
+/** @brief A constant for the spatial epsilon value, relative to the unit. */
+#define loc_EPS 1e-13
+#endif
+
+#else
+/* Times and locations are stored as `long double`, the reference precision. */
+
 /** @brief An alias to the type used for times. */
 typedef long double time_t;
 /** @brief The printing format relative to the time type. */
@@ -41,6 +75,8 @@ typedef long double time_t;
 typedef long double loc_t;
 /** @brief The printing format relative to the location type. */
 #define loc_F "Lf"
+/** @brief The number of significant digits printing a location without loss. */
+#define loc_DIG 21
 /** @brief A constant for the spatial unit. */
 #define loc_UNIT 1.0
 #ifndef loc_EPS
@@ -48,10 +84,14 @@ typedef long double loc_t;
 #define loc_EPS 1e-16
 #endif
 
+#endif
+
 /** @brief An alias to the type used for masses. */
 typedef double mass_t;
 /** @brief The printing format relative to the mass type. */
 #define mass_F "lf"
+/** @brief The number of significant digits printing a mass without loss. */
+#define mass_DIG 17
 /** @brief A constant for the mass unit. */
 #define mass_UNIT 1.0
 
@@ -84,7 +124,7 @@ time_t path_time(loc_t dist, loc_t speed);
  * @param loc2  second vector to append
  * @param k     multiplier of the second vector
  */
-void loc_append (loc_t loc[NB_DIM], loc_t const loc2[NB_DIM], long double k);
+void loc_append (loc_t loc[NB_DIM], loc_t const loc2[NB_DIM], loc_t k);
 
 /** @brief Compute the difference of two vectors.
  *
@@ -0,0 +1,63 @@
+/** @file process.h
+ *
+ * @brief Worker processes connected to their parent by Unix-domain sockets.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * Each worker is a forked copy of the parent, with its own end of a socket
+ * pair, called a channel. A worker exits when its function returns, which
+ * it should do once its parent closes the channel.
+ *
+ * This module is kept apart because `<sys/types.h>` cannot be included
+ * along with `physics.h`, which defines its own `time_t`.
+ */
+
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @brief A function run by each worker process.
+ * @param data  the data of the parent, as it was when the worker was started
+ * @param worker  index of the worker, from `0` to the number of workers excluded
+ * @param channel  the end of the channel held by the worker
+ */
+typedef void (*process_func_t)(void *data, size_t worker, int channel);
+
+/** @brief Start worker processes.
+ *
+ * Workers are started in order, until one cannot be.
+ * @param nb_workers  number of workers
+ * @param func  function run by each worker
+ * @param data  data given to every worker
+ * @param channels  filled with the end of the channel held by the parent, for each worker
+ * @param pids  filled with the process identifier of each worker
+ * @return  number of workers started
+ */
+size_t process_spawn (size_t nb_workers, process_func_t func, void *data, int channels[], long pids[]);
+
+/** @brief Write a whole buffer to a channel.
+ * @param channel  the channel
+ * @param buffer  the bytes to write
+ * @param size  number of bytes
+ * @return  `true` if every byte was written, `false` if the other end is closed (no `SIGPIPE` is raised)
+ */
+bool process_send (int channel, void const *buffer, size_t size);
+
+/** @brief Read a whole buffer from a channel.
+ * @param channel  the channel
+ * @param buffer  filled with the bytes read
+ * @param size  number of bytes
+ * @return  `true` if every byte was read, `false` if the other end is closed
+ */
+bool process_receive (int channel, void *buffer, size_t size);
+
+/** @brief Close the channels of the workers, and wait for them to exit.
+ * @param nb_workers  number of workers started
+ * @param channels  the ends of the channels held by the parent
+ * @param pids  the process identifiers of the workers
+ */
+void process_join (size_t nb_workers, int const channels[], long const pids[]);
+
+#endif
@@ -0,0 +1,146 @@
+/** @file radix.h
+ *
+ * @brief Simple definition of a monotone radix heap containing pointers to values.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * This heap does not handle NULL values.
+ *
+ * Values are ordered by an unsigned integer {@link heap_key_t key} embedded
+ * in each value, like a keyed binary heap. The heap is monotone: keys are
+ * expected to be no lower than the last extracted key, which holds for the
+ * events of a simulation. A value inserted with a lower key is handled as if
+ * its key was the last extracted key, so it is extracted next.
+ *
+ * Values are spread into buckets by the highest bit in which their key
+ * differs from the last extracted key. Extracting from an empty first bucket
+ * redistributes the first non-empty bucket into lower buckets: since a
+ * value only moves to lower buckets, inserting a value and extracting the
+ * minimum value have an amortized complexity in $O(b)$ where $b$ is the
+ * number of bits of the keys, independently of the size of the heap.
+ *
+ * The API of the radix heap is defined as follows:
+ *
+ * - a function to create an empty radix heap
+ * - a function to get the size of the heap
+ * - a function to insert a new value in the heap
+ * - a function to get the minimum value in the heap
+ * - a function to remove the values failing a predicate
+ * - a function to read again the keys of the values
+ * - a function to deallocate the radix heap
+ */
+
+#ifndef RADIX_H
+#define RADIX_H
+
+#include "heap.h"
+#include <stddef.h>
+
+/** @brief An alias to the structure representing a radix heap. */
+typedef struct radix radix_t;
+
+/** @brief The structure representing the radix heap. */
+struct radix;
+
+
+
+/**
+ * @brief Create a nil radix heap.
+ *
+ * Every value holds a {@link heap_key_t key} at offset `key_offset`, which
+ * must not change while the value is in the heap, unless
+ * {@link radix_rekey} is called right after.
+ *
+ * @param key_offset  the offset of the key inside the values,
+ *                    as given by `offsetof`
+ *
+ * @param tie  the comparator ordering values of equal keys, only called
+ *             on such values - use `NULL` if not needed
+ *
+ * @param deallocate_value  the function charged to deallocate values -
+ *                          use `NULL`if not needed
+ *
+ * @return  a new empty radix heap
+ */
+radix_t *radix_new_keyed (size_t key_offset, compare_func_t tie, operate_func_t deallocate_value);
+
+/**
+ * @brief Get the number of values in the radix heap.
+ *
+ * @param p_radix  a pointer to the heap
+ *
+ * @return  the number of values in `p_radix`
+ *
+ * @pre  `p_radix` is not `NULL`
+ */
+size_t radix_size (radix_t const *p_radix);
+
+/**
+ * @brief Insert a new value in the radix heap.
+ *
+ * If the inserted value is `NULL`, it is ignored. If its key is lower than
+ * the last extracted key, it is extracted before any other value.
+ *
+ * @param p_radix  a pointer to the heap in which the value is
+ *                 to be inserted
+ * @param value    the value to be inserted
+ *
+ * @pre  `p_radix` is not `NULL`
+ */
+void radix_insert (radix_t *p_radix, void *value);
+
+/** @brief Extract the minimum value in the radix heap.
+ *
+ * Once the heap is empty, the last extracted key is forgotten, so that
+ * any key can be inserted again.
+ *
+ * @param p_radix  a pointer to the heap from which the value is
+ *                 to be extracted
+ *
+ * @return  the minimum value in the radix heap, or `NULL` if the heap is empty
+ *
+ * @pre  `p_radix` is not `NULL`
+ */
+void *radix_extract_min (radix_t *p_radix);
+
+/** @brief Remove every value failing a predicate from the radix heap.
+ *
+ * Removed values are not deallocated: `keep` may deallocate the values
+ * it rejects. Buckets holding few values are shrunk.
+ *
+ * @param p_radix  a pointer to the heap to be filtered
+ * @param keep     the predicate, called once on every value
+ * @param data     data given to every call of `keep`
+ *
+ * @return  the number of removed values
+ *
+ * @pre  `p_radix` is not `NULL`
+ */
+size_t radix_filter (radix_t *p_radix, filter_func_t keep, void *data);
+
+/** @brief Read again the keys of every value, after they were changed in place.
+ *
+ * Values are moved to the buckets of their new keys, relatively to a new
+ * last extracted key: as for an insertion, a value whose key is lower than
+ * `last` is extracted before any other value. The execution time is in
+ * \f$O(n)\f$ where \f$n\f$ is the size of the radix heap.
+ *
+ * @param p_radix  a pointer to the heap whose keys have changed
+ * @param last     the new last extracted key, ignored if the heap is empty
+ *
+ * @pre  `p_radix` is not `NULL`
+ */
+void radix_rekey (radix_t *p_radix, heap_key_t last);
+
+/** @brief Deallocate the radix heap and free the pointer.
+ *
+ * @param p_radix  a pointer to the radix heap to be deallocated
+ *
+ * @pre  `p_radix` is not `NULL`
+ *
+ * @post  After the call, all memory regions used for the buckets
+ *        are deallocated. Values are also deallocated.
+ */
+void radix_deallocate (radix_t *p_radix);
+
+#endif
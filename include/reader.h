@@ -0,0 +1,55 @@
+/** @file reader.h
+ *
+ * @brief Parallel parsing of particles described as text.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * A text file starts with a line of description, then the number of
+ * particles, then one line per particle:
+ * `position,velocity,mass,radius` (`NB_DIM` values for each vector,
+ * separated by commas or blanks). Blank lines are ignored.
+ *
+ * The whole file is read at once, split at line boundaries, and the lines
+ * are parsed by several threads, each one writing its own particles to the
+ * store. Numbers are parsed without `scanf`: those with few enough digits
+ * are converted exactly with a single product, the others go through
+ * `strtod`, so values are the same as the ones `scanf` would read.
+ */
+
+#ifndef READER_H
+#define READER_H
+
+#include "particle.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/** @brief Where and why the reading of a file failed. */
+typedef struct {
+    /** @brief Line of the error, from `1`. */
+    size_t line;
+
+    /** @brief Column of the error, from `1`. */
+    size_t column;
+
+    /** @brief Description of the error, or `NULL` if there is no error. */
+    char const *reason;
+} load_error_t;
+
+/** @brief Append particles read from a file to a store.
+ * @param particles  store to fill, grown to the number of particles declared by the file
+ * @param file  file from which to read
+ * @param raw  `false` if values are relative to types unit, `true` if they are in raw data type;
+ *             locations are read with the precision of their type either way
+ * @param error  filled with the position of the first error, if not `NULL`
+ * @return  number of particles read, or `0` if an error occured (the store is then left unchanged)
+ */
+size_t reader_load (particles_t *particles, FILE* file, bool raw, load_error_t *error);
+
+/** @brief Print a reading error, as `path:line:column: reason`.
+ * @param path  name of the file read
+ * @param error  the error
+ * @param stream  stream to which to print
+ */
+void reader_print_error (char const *path, load_error_t const *error, FILE *stream);
+
+#endif
@@ -0,0 +1,203 @@
+/** @file scheduler.h
+ *
+ * @brief Queue of the future events of a simulation.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * Events are scheduled into slots: the simulation uses one slot per
+ * particle (the particle for which the event was predicted) and extra
+ * slots for events which do not belong to any particle.
+ *
+ * The available implementations are:
+ * - {@link SCHEDULER_HEAP}: every scheduled event is kept in a binary heap
+ *   until it is extracted, even if it has been invalidated meanwhile.
+ * - {@link SCHEDULER_TOURNAMENT}: only the earliest event of each slot is kept,
+ *   in a tournament tree indexed by slot, so the queue never holds more
+ *   events than slots.
+ * - {@link SCHEDULER_RADIX}: like {@link SCHEDULER_HEAP}, but in a radix heap
+ *   which relies on extracted events never going back in time.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "event.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @brief Enumeration of the different scheduler implementations.
+ * @see scheduler_new
+ */
+enum scheduler_type {
+    /** @brief Global binary heap, stale events are discarded at extraction. */
+    SCHEDULER_HEAP,
+
+    /** @brief Tournament tree keeping only the earliest event of each slot.
+     *
+     * When an event is extracted, its slot becomes empty: the caller is
+     * responsible of scheduling the next events of that slot.
+     */
+    SCHEDULER_TOURNAMENT,
+
+    /** @brief Global monotone radix heap, stale events are discarded at extraction.
+     *
+     * Scheduling and extraction cost a constant amortized time instead of
+     * a logarithmic one. An event scheduled before the last extracted one
+     * is extracted next.
+     */
+    SCHEDULER_RADIX,
+};
+
+/** @brief An alias to the structure representing a scheduler. */
+typedef struct scheduler scheduler_t;
+
+/** @brief The structure representing a scheduler. */
+struct scheduler;
+
+
+
+/** @brief Get a scheduler implementation from its name.
+ * @param name  name of the implementation (`"heap"`, `"tournament"` or `"radix"`)
+ * @param type  filled with the implementation
+ * @return  `true` if the name is known
+ */
+bool scheduler_type_parse (char const *name, enum scheduler_type *type);
+
+/** @brief Get the name of a scheduler implementation.
+ * @param type  the implementation
+ * @return  the name of the implementation
+ */
+char const *scheduler_type_name (enum scheduler_type type);
+
+/** @brief Create an empty scheduler.
+ * @param type  the implementation to use
+ * @param nb_slots  the number of slots
+ * @param pool  the pool from which the scheduled events are allocated
+ * @return  a new empty scheduler
+ */
+scheduler_t *scheduler_new (enum scheduler_type type, size_t nb_slots, event_pool_t *pool);
+
+/** @brief Estimate the memory used by a scheduler.
+ *
+ * The estimate covers the pending events themselves and the worst case of
+ * the amortized growth of the queue, so it is an upper bound of the memory
+ * needed to hold `nb_events` events at once.
+ * @param type  the implementation
+ * @param nb_slots  the number of slots
+ * @param nb_events  the number of pending events
+ * @return  the number of bytes
+ */
+size_t scheduler_memory (enum scheduler_type type, size_t nb_slots, size_t nb_events);
+
+/** @brief Get the number of pending events a scheduler can hold within a memory budget.
+ *
+ * A {@link SCHEDULER_TOURNAMENT} never holds more events than slots, while
+ * a {@link SCHEDULER_HEAP} or a {@link SCHEDULER_RADIX} grows with the number
+ * of pending events.
+ * @param type  the implementation
+ * @param nb_slots  the number of slots
+ * @param budget  the number of bytes available
+ * @return  the maximal number of pending events, `0` if even an empty scheduler does not fit
+ * @see scheduler_memory
+ */
+size_t scheduler_capacity (enum scheduler_type type, size_t nb_slots, size_t budget);
+
+/** @brief Does the scheduler forget the events which are not the earliest of their slot?
+ *
+ * If it does, the caller must schedule again every event of a slot
+ * each time an event of that slot is extracted.
+ * @param s  the scheduler
+ * @return  `true` for {@link SCHEDULER_TOURNAMENT}
+ */
+bool scheduler_keeps_earliest_only (scheduler_t const *s);
+
+/** @brief Schedule a new event.
+ *
+ * The scheduler takes ownership of the event, and may release it
+ * to the pool immediately if it is not needed.
+ * @param s  the scheduler
+ * @param slot  the slot of the event
+ * @param e  the event, ignored if `NULL`
+ */
+void scheduler_schedule (scheduler_t *s, size_t slot, event_t *e);
+
+/** @brief Schedule many new events at once.
+ *
+ * This is faster than scheduling the events one by one, for example when
+ * filling an empty scheduler.
+ * @param s  the scheduler
+ * @param slots  the slot of each event
+ * @param events  the events, `NULL` ones are ignored
+ * @param count  the number of events
+ * @see scheduler_schedule
+ */
+void scheduler_schedule_bulk (scheduler_t *s, size_t const slots[], event_t *events[], size_t count);
+
+/** @brief Forget every event of a slot, if the implementation permits it.
+ *
+ * Use this when the events of the slot are known to be invalid, or to have
+ * all been extracted.
+ * @param s  the scheduler
+ * @param slot  the slot to clear
+ */
+void scheduler_forget (scheduler_t *s, size_t slot);
+
+/** @brief Estimate the number of stale events held by the scheduler.
+ *
+ * Events of a slot are known to be stale once the slot has been
+ * {@link scheduler_forget forgotten}. Events invalidated through their
+ * second particle are not counted, so this is a lower bound.
+ * @param s  the scheduler
+ * @return  the estimated number of stale events, always `0` for {@link SCHEDULER_TOURNAMENT}
+ */
+size_t scheduler_stale (scheduler_t const *s);
+
+/** @brief Release every event which is no longer valid.
+ *
+ * Validity is checked against the collision counters of the particles,
+ * see {@link event_is_valid}. The queue is then rebuilt with the remaining
+ * events in linear time, and shrunk if possible.
+ * @param s  the scheduler
+ * @param particles  the particles the events refer to
+ * @return  the number of released events
+ */
+size_t scheduler_compact (scheduler_t *s, particles_t const *particles);
+
+/** @brief Release every pending event, without extracting them one by one.
+ * @param s  the scheduler
+ */
+void scheduler_clear (scheduler_t *s);
+
+/** @brief Move every pending event earlier, keeping their order.
+ *
+ * This is used when the origin of time moves to `shift`: the execution
+ * time is linear in the number of pending events, instead of predicting
+ * them all again. Events scheduled afterwards must not be earlier than
+ * the new origin.
+ * @param s  the scheduler
+ * @param shift  time by which the events are moved earlier
+ */
+void scheduler_shift (scheduler_t *s, time_t shift);
+
+/** @brief Extract the earliest event.
+ * @param s  the scheduler
+ * @return  the earliest event, or `NULL` if the scheduler is empty -
+ *          the caller is responsible of releasing it
+ */
+event_t *scheduler_extract_min (scheduler_t *s);
+
+/** @brief Get the number of events held by the scheduler.
+ * @param s  the scheduler
+ * @return  the number of pending events
+ */
+size_t scheduler_size (scheduler_t const *s);
+
+/** @brief Deallocate the scheduler.
+ *
+ * Pending events are not released one by one: they are given back
+ * to the system along with their pool.
+ * @param s  the scheduler
+ */
+void scheduler_deallocate (scheduler_t *s);
+
+#endif
@@ -4,68 +4,288 @@
  *
  * @author Jean-Raphaël GAGLIONE
  *
+ * A {@link simulation_t simulation} keeps its queue of future events and its
+ * neighbor search from a call to the next: it can be advanced step by step,
+ * have particles added or its time reversed, without predicting every event
+ * again. {@link simulation_loop} runs a whole simulation at once.
  */
 
 #ifndef SIMULATION_H
 #define SIMULATION_H
 
 #include "particle.h"
+#include "scheduler.h"
+#include "neighbors.h"
+#include "event.h"
+#include "reader.h"
 #include <stddef.h>
 #include <stdio.h>
 
+/** @brief An alias to the structure representing simulation statistics. */
+typedef struct simulation_stats simulation_stats_t;
+
+/** @brief The structure representing simulation statistics. */
+struct simulation_stats {
+    /** @brief Number of processed events (collisions and cell crossings). */
+    size_t nb_events;
+
+    /** @brief Number of extracted events discarded because they were no longer valid. */
+    size_t nb_invalid;
+
+    /** @brief Number of processed {@link EVENT_CROSS_CELL cell crossing events}. */
+    size_t nb_crossings;
+
+    /** @brief Maximal number of events pending in the scheduler. */
+    size_t max_pending;
+
+    /** @brief Number of times the scheduler was compacted, see {@link simulation_options.compaction_threshold}. */
+    size_t nb_compactions;
+
+    /** @brief Number of stale events released by compactions. */
+    size_t nb_compacted;
+
+    /** @brief Memory of the queue reclaimed by compactions, in bytes, see {@link scheduler_memory}. */
+    size_t compacted_memory;
+
+    /** @brief Number of times the epoch was moved, see {@link simulation_options.epoch_period}. */
+    size_t nb_epochs;
+
+    /** @brief Number of windows committed by the parallel engine, see {@link simulation_options.nb_domains}. */
+    size_t nb_windows;
+
+    /** @brief Number of windows the parallel engine ran again, see {@link simulation_options.nb_domains}. */
+    size_t nb_rollbacks;
+
+    /** @brief Wall-clock time spent computing the events of the initial state, in seconds. */
+    double startup_time;
+
+    /** @brief Counters of the pool from which the events were allocated. */
+    event_pool_stats_t pool;
+};
+
+/** @brief An alias to the structure representing simulation options. */
+typedef struct simulation_options simulation_options_t;
+
+/** @brief The structure representing simulation options. */
+struct simulation_options {
+    /** @brief Implementation of the queue of future events. */
+    enum scheduler_type scheduler;
+
+    /** @brief Implementation of the search of collision candidates. */
+    enum neighbors_type neighbors;
+
+    /** @brief Fraction of stale events above which the scheduler is compacted - use `0` to never compact it.
+     *
+     * Stale events are estimated with {@link scheduler_stale}, and released
+     * by {@link scheduler_compact}, when the queue holds more events than particles.
+     */
+    double compaction_threshold;
+
+    /** @brief Simulated time after which the epoch is moved - use `0` to never move it.
+     *
+     * Absolute timestamps lose resolution as they grow, mostly in double precision.
+     * When the epoch is moved, particle snapshots are shifted so that the
+     * current time becomes their origin, and so are the pending events, in
+     * a single pass over them. Callbacks are then given times relative to
+     * the current epoch, like the snapshots, see {@link simulation_epoch}.
+     * Snapshots are absolute again when the simulation is destroyed.
+     */
+    time_t epoch_period;
+
+    /** @brief Number of threads predicting the collisions of a particle with many candidates - use `0` or `1` for one thread.
+     *
+     * The threads are kept in a pool as long as the simulation runs. Without
+     * a neighbor search ({@link NEIGHBORS_ALL}), they also share the
+     * prediction of every event of the initial state. Events are the same as
+     * with one thread, in the same order.
+     */
+    size_t nb_threads;
+
+    /** @brief Number of candidates from which the collisions of a particle are predicted by every thread, see {@link simulation_options.nb_threads}. */
+    size_t parallel_candidates;
+
+    /** @brief Number of spatial domains advanced in parallel by {@link simulation_loop} - use `0` or `1` for the serial engine.
+     *
+     * See {@link domains.h}: the observer is then used by the engine.
+     */
+    size_t nb_domains;
+
+    /** @brief Are the domains run by worker processes, connected by Unix-domain sockets, instead of threads?
+     *
+     * See {@link domains.h}: each window, a worker receives the particles of
+     * its domain and sends them back advanced.
+     */
+    bool domain_processes;
+
+    /** @brief If not `NULL`, called after every collision, with the store and the indexes of the particles.
+     *
+     * The second index is `EVENT_NO_PARTICLE` for a collision with a wall.
+     */
+    void (*observer)(particles_t const *particles, size_t a, size_t b, void *data);
+
+    /** @brief Data given to the observer. */
+    void *observer_data;
+
+    /** @brief If not `NULL`, filled with the statistics of the simulation when it is destroyed. */
+    simulation_stats_t *stats;
+};
+
+/** @brief Options used when none are specified. */
+extern simulation_options_t const SIMULATION_DEFAULT_OPTIONS;
+
+/** @brief An alias to the structure representing a running simulation. */
+typedef struct simulation simulation_t;
+
+/** @brief The structure representing a running simulation. */
+struct simulation;
+
+/** @brief Start a simulation, predicting every event of the initial state.
+ *
+ * The simulation starts from the oldest snapshot, and owns the snapshots of
+ * the store until it is destroyed.
+ * @param particles  store of the particles used in the simulation (at most \f$2^{32}-1\f$)
+ * @param time_flow  direction of time (`1` or `-1`)
+ * @param options  options of the simulation - use `NULL` for {@link SIMULATION_DEFAULT_OPTIONS}
+ * @return  a new simulation
+ */
+simulation_t *simulation_new (particles_t *particles, int time_flow, simulation_options_t const *options);
+
+/** @brief Start a simulation at a given time, predicting every event from then.
+ *
+ * Snapshots may be older than that time: they are kept as they are, and
+ * only events after it are predicted.
+ * @param particles  store of the particles used in the simulation (at most \f$2^{32}-1\f$)
+ * @param time_flow  direction of time (`1` or `-1`)
+ * @param timestamp  absolute time at which the simulation starts
+ * @param options  options of the simulation - use `NULL` for {@link SIMULATION_DEFAULT_OPTIONS}
+ * @return  a new simulation
+ */
+simulation_t *simulation_new_at (particles_t *particles, int time_flow, time_t timestamp, simulation_options_t const *options);
+
+/** @brief Get the current time of a simulation.
+ * @param sim  the simulation
+ * @return  absolute current time
+ */
+time_t simulation_time (simulation_t const *sim);
+
+/** @brief Get the origin of the particle snapshots, see {@link simulation_options.epoch_period}.
+ *
+ * The position of a particle at an absolute time `t` is given by
+ * {@link particles_position_at} at `t-simulation_epoch(sim)`.
+ * @param sim  the simulation
+ * @return  absolute time of the origin of the snapshots
+ */
+time_t simulation_epoch (simulation_t const *sim);
+
+/** @brief Process every event up to a time.
+ *
+ * Nothing is done if the time is already past, in the direction of time.
+ * @param sim  the simulation
+ * @param timestamp  absolute time to reach
+ */
+void simulation_advance_to (simulation_t *sim, time_t timestamp);
+
+/** @brief Add a particle to a running simulation.
+ *
+ * The particle is moved to the current time, and only its own events are
+ * predicted. If the store has outgrown the queue or the neighbor search,
+ * they are created again for its new capacity, which grows geometrically.
+ * The particle must not overlap any other.
+ * @param sim  the simulation
+ * @param p  the particle, with an absolute snapshot
+ * @return  index of the particle in the store
+ */
+size_t simulation_add_particle (simulation_t *sim, particle_t const *p);
+
+/** @brief Reverse the direction of time of a simulation.
+ *
+ * Every particle is moved to the current time, from which its events are
+ * predicted again in the other direction. Retracing its path, a particle
+ * which collided since the last reversal next meets the partner of its last
+ * collision, which is the only one predicted: candidates are only searched
+ * for the other particles.
+ * @param sim  the simulation
+ */
+void simulation_reverse_time (simulation_t *sim);
+
+/** @brief Stop a simulation.
+ *
+ * The particles are moved to the current time, with absolute snapshots,
+ * and the statistics are reported, see {@link simulation_options.stats}.
+ * @param sim  the simulation, which is deallocated
+ */
+void simulation_destroy (simulation_t *sim);
+
 /** @brief Run simulation loop.
- * @param particle_list  list of particles used in the simulation
- * @param nb_part  lenght of `particle_list`
+ * @param particles  store of the particles used in the simulation (at most \f$2^{32}-1\f$)
  * @param duration  duration of the simulation (use negative time to run backward)
  * @param callback  callback function (for example a drawing function)
- * @param callback_rate  time between two callback
+ * @param callback_rate  time between two callback (use `0` to disable callbacks)
+ * @param options  options of the simulation - use `NULL` for {@link SIMULATION_DEFAULT_OPTIONS}
  */
-void simulation_loop (particle_t *particle_list[], size_t nb_part, time_t duration, void (*callback)(time_t timestamp), time_t callback_rate);
+void simulation_loop (particles_t *particles, time_t duration, void (*callback)(time_t timestamp), time_t callback_rate, simulation_options_t const *options);
 
 
-/** @brief Fill a list of particles from a file.
+/** @brief Append particles read from a file to a store.
  *
- * Values are described as doubles, relative to types unit (location/time/mass).
- * @param particle_list  list to fill
- * @param max_count  max number of particle that can be read - more particles are considered as an error
+ * Values are described relative to types unit (location/time/mass), and
+ * locations are read with the precision of their type.
+ * See {@link reader.h} for the format.
+ * @param particles  store to fill, grown to the number of particles declared by the file
  * @param file  file from which to read
- * @return  number of particles read, or `-1` if an error occured
+ * @param error  filled with the line and column of the first error, if not `NULL`
+ * @return  number of particles read, or `0` if an error occured (the store is then left unchanged)
  */
-size_t load_particles (particle_t *particle_list[], size_t max_count, FILE* file);
+size_t load_particles (particles_t *particles, FILE* file, load_error_t *error);
 
-/** @brief Fill a list of particles from a file.
- * @param particle_list  list to fill
- * @param max_count  max number of particle that can be read - more particles are considered as an error
+/** @brief Append particles read from a file to a store.
+ *
+ * Values are described as raw data type (location/time/mass).
+ * @param particles  store to fill, grown to the number of particles declared by the file
  * @param file  file from which to read
- * @return  number of particles read, or `-1` if an error occured
+ * @param error  filled with the line and column of the first error, if not `NULL`
+ * @return  number of particles read, or `0` if an error occured (the store is then left unchanged)
  */
-size_t load_raw_particles (particle_t *particle_list[], size_t max_count, FILE* file);
+size_t load_raw_particles (particles_t *particles, FILE* file, load_error_t *error);
 
-/** @brief Fill a list of particles with random particles.
+/** @brief Append random particles to a store.
  *
  * Values are described as raw data type (location/time/mass).
- * @param particle_list  list to fill
+ * @param particles  store to fill
+ * @param count  number of particle to generate
+ */
+void generate_particles (particles_t *particles, size_t count, unsigned int seed);
+
+/** @brief Append random particles packed on a lattice to a store.
+ *
+ * Particles are spread over the sites of a checkerboard lattice (square in
+ * 2D, face-centered cubic in 3D) and jittered around them, never far enough
+ * to overlap: no placement is ever rejected, and dense packings are reached
+ * in linear time. Values are described as raw data type (location/time/mass).
+ * @param particles  store to fill
  * @param count  number of particle to generate
+ * @param packing_fraction  fraction of the box to fill with particles - the
+ *        lattice caps it around 0.7 in 2D and 0.63 in 3D
+ * @return  fraction of the box filled by the particles
  */
-void generate_particles (particle_t *particle_list[], size_t count, unsigned int seed);
+long double generate_packed_particles (particles_t *particles, size_t count, long double packing_fraction, unsigned int seed);
 
 
-/** @brief Export a list of particles to a file.
+/** @brief Export a store of particles to a file.
  *
- * Values are described as doubles, relative to types unit (location/time/mass).
- * @param particle_list  list to export
- * @param count  number of particle to export
+ * Values are described relative to types unit (location/time/mass), with
+ * enough digits to be loaded back without loss by {@link load_particles}.
+ * @param particles  store to export
  * @param file  file to which to write
  */
-void export_particles (particle_t *particle_list[], size_t count, FILE* file, char *header);
+void export_particles (particles_t const *particles, FILE* file, char *header);
 
-/** @brief Export a list of particles to a file.
+/** @brief Export a store of particles to a file.
  *
  * Values are described as raw data type (location/time/mass).
- * @param particle_list  list to export
- * @param count  number of particle to export
+ * @param particles  store to export
  * @param file  file to which to write
  */
-void export_raw_particles (particle_t *particle_list[], size_t count, FILE* file, char *header);
+void export_raw_particles (particles_t const *particles, FILE* file, char *header);
 
 #endif
@@ -0,0 +1,62 @@
+/** @file snapshot.h
+ *
+ * @brief Binary snapshots of a store of particles, loaded by mapping them in memory.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * A snapshot starts with a header describing its layout: format version,
+ * number of dimentions, size of each value type and number of particles,
+ * followed by a short description. The arrays of the {@link particles}
+ * store follow, in their raw data type (location/time/mass), each one
+ * aligned on {@link SNAPSHOT_ALIGNMENT} bytes.
+ *
+ * When the snapshot was written by a build using the same value types, the
+ * store is loaded without copy: its arrays point into the mapped file, and
+ * the pages are only copied when the simulation writes to them. Otherwise,
+ * values are converted to the types of the build.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "particle.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/** @brief Version of the snapshot format, increased at every incompatible change. */
+#define SNAPSHOT_VERSION 1
+
+/** @brief Size of the description of a snapshot, including the terminating null character. */
+#define SNAPSHOT_DESCRIPTION_SIZE 256
+
+/** @brief Alignment of the arrays in a snapshot, so that they can be used in place. */
+#define SNAPSHOT_ALIGNMENT 64
+
+
+
+/** @brief Tell whether a file is a snapshot.
+ * @param path  path of the file
+ * @return  `true` if the file starts like a snapshot
+ */
+bool snapshot_check (char const *path);
+
+/** @brief Load a store of particles from a snapshot.
+ *
+ * The store holds exactly the particles of the snapshot: it is full.
+ * @param path  path of the snapshot
+ * @param description  filled with the description of the snapshot, if not `NULL`
+ * @return  a new store of particles, or `NULL` if the file is not a valid snapshot
+ */
+particles_t *snapshot_load (char const *path, char description[SNAPSHOT_DESCRIPTION_SIZE]);
+
+/** @brief Export a store of particles to a snapshot.
+ *
+ * Values are written without conversion, in raw data type (location/time/mass).
+ * @param particles  store to export
+ * @param file  file to which to write, opened in binary mode
+ * @param header  description of the snapshot, truncated to fit
+ * @return  `true` if the snapshot was written
+ */
+bool export_snapshot (particles_t const *particles, FILE* file, char const *header);
+
+#endif
@@ -0,0 +1,101 @@
+/** @file sweep.h
+ *
+ * @brief Sweep and prune over bounding boxes, used to find neighbor particles.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * Each particle is bounded by its own box, centered on a point of its path,
+ * which is wider than the particle by a margin along every dimention. As long
+ * as the center of the particle stays within the margin, the particle stays
+ * in its box, so two particles can only touch each other if their boxes
+ * overlap. Small particles get small boxes, whatever the size of the
+ * biggest particle.
+ *
+ * Boxes are kept sorted by center along every dimention. A query sweeps the
+ * dimention along which the fewest boxes may overlap, and prunes the boxes
+ * which do not overlap along the other dimentions.
+ *
+ * Particles are identified by their index. A box only moves by a margin
+ * when the center of its particle reaches one of its faces, see
+ * {@link sweep_move}: it is then sorted again by insertion.
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "physics.h"
+#include <stddef.h>
+
+/** @brief An alias to the structure representing a sweep and prune. */
+typedef struct sweep sweep_t;
+
+/** @brief The structure representing a sweep and prune. */
+struct sweep;
+
+
+
+/** @brief Create an empty sweep and prune.
+ * @param nb_part  number of particles which can be registered
+ * @param margin  distance the center of a particle can travel before its box moves
+ * @return  a new sweep and prune, with no particle registered
+ */
+sweep_t *sweep_new (size_t nb_part, loc_t margin);
+
+/** @brief Register a particle, with a box centered on a position.
+ *
+ * Particles registered before the first query are sorted at once. After
+ * it, a particle must have the next index, and its box is inserted in place.
+ * @param s  the sweep and prune
+ * @param i  index of the particle
+ * @param position  position of the particle
+ * @param radius  radius of the particle
+ */
+void sweep_insert (sweep_t *s, size_t i, loc_t const position[NB_DIM], loc_t radius);
+
+/** @brief Move the box of a particle by a margin.
+ * @param s  the sweep and prune
+ * @param i  index of the particle
+ * @param dim  dimention orthogonal to the crossed face
+ * @param dir  `1` to move toward higher coordinates, `-1` else
+ */
+void sweep_move (sweep_t *s, size_t i, size_t dim, int dir);
+
+/** @brief Get the position the center of a particle reaches when it leaves the margin of its box.
+ * @param s  the sweep and prune
+ * @param i  index of the particle
+ * @param dim  dimention orthogonal to the face
+ * @param dir  `1` for the face with higher coordinates, `-1` else
+ * @return  position of the face along the `dim` axis, or `NEVER` if a wall of
+ *          the box stops the particle before
+ */
+loc_t sweep_face (sweep_t const *s, size_t i, size_t dim, int dir);
+
+/** @brief Get the particles whose box overlaps the box of a particle.
+ *
+ * The particle itself is part of the result.
+ * @param s  the sweep and prune
+ * @param i  index of the particle
+ * @param count  filled with the number of neighbors
+ * @return  the indexes of the neighbors, valid until the next call on `s`
+ */
+size_t const *sweep_neighbors (sweep_t *s, size_t i, size_t *count);
+
+/** @brief Get the particles whose box just started to overlap the box of a particle.
+ *
+ * After the box of a particle moved along `dim` in direction `dir`, some
+ * boxes beyond it in that direction may overlap it.
+ * @param s  the sweep and prune
+ * @param i  index of the particle
+ * @param dim  dimention along which the box moved
+ * @param dir  direction in which the box moved
+ * @param count  filled with the number of neighbors
+ * @return  the indexes of the neighbors, valid until the next call on `s`
+ */
+size_t const *sweep_new_neighbors (sweep_t *s, size_t i, size_t dim, int dir, size_t *count);
+
+/** @brief Deallocate the sweep and prune.
+ * @param s  the sweep and prune
+ */
+void sweep_deallocate (sweep_t *s);
+
+#endif
@@ -0,0 +1,156 @@
+/** @file tournament.h
+ *
+ * @brief Simple definition of a tournament tree containing one pointer per leaf.
+ *
+ * @author Jean-Raphaël GAGLIONE
+ *
+ * A tournament tree has a fixed number of leaves, each of them holding
+ * at most one value (`NULL` meaning no value). Every internal node
+ * remembers which leaf holds the minimum value of its subtree, so the
+ * minimum value of the whole tree is found at the root.
+ *
+ * As in a {@link heap.h binary heap}, values are ordered either by a
+ * comparator function or by a key embedded in each value.
+ *
+ * Replacing the value of a leaf updates the path from this leaf to the
+ * root, thus has a worst-case complexity in $O(\log n)$ where $n$ is the
+ * number of leaves, and the number of stored values never exceeds $n$.
+ *
+ * The API of the tournament tree is defined as follows:
+ *
+ * - a function to create a tree with empty leaves
+ * - a function to create a keyed tree with empty leaves
+ * - a function to get the value of a leaf
+ * - a function to replace the value of a leaf
+ * - a function to extract the minimum value of the tree
+ * - a function to remove every value failing a predicate
+ * - a function to deallocate the tree
+ */
+
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include "heap.h"
+#include <stddef.h>
+
+/** @brief An alias to the structure representing a tournament tree. */
+typedef struct tournament tournament_t;
+
+/** @brief The structure representing the tournament tree. */
+struct tournament;
+
+
+
+/**
+ * @brief Create a tournament tree with empty leaves.
+ *
+ * @param nb_leaves  the number of leaves of the tree
+ *
+ * @param comparator  the comparator function used by the elements
+ *
+ * @param deallocate_value  the function charged to deallocate values -
+ *                          use `NULL`if not needed
+ *
+ * @return  a new tournament tree
+ *
+ * @pre  `comparator` is not `NULL`
+ */
+tournament_t *tournament_new (size_t nb_leaves, compare_func_t comparator, operate_func_t deallocate_value);
+
+/**
+ * @brief Create a keyed tournament tree with empty leaves.
+ *
+ * Every value holds a {@link heap_key_t key} at offset `key_offset`, which
+ * must not change while the value is in the tree, except within
+ * {@link tournament_filter}.
+ *
+ * @param nb_leaves  the number of leaves of the tree
+ *
+ * @param key_offset  the offset of the key inside the values,
+ *                    as given by `offsetof`
+ *
+ * @param tie  the comparator ordering values of equal keys, only called
+ *             on such values - use `NULL` if not needed
+ *
+ * @param deallocate_value  the function charged to deallocate values -
+ *                          use `NULL`if not needed
+ *
+ * @return  a new tournament tree
+ */
+tournament_t *tournament_new_keyed (size_t nb_leaves, size_t key_offset, compare_func_t tie, operate_func_t deallocate_value);
+
+/**
+ * @brief Get the value of a leaf.
+ *
+ * @param p_tree  a pointer to the tournament tree
+ * @param leaf    index of the leaf
+ *
+ * @return  the value of the leaf, or `NULL` if the leaf is empty
+ *
+ * @pre  `p_tree` is not `NULL` and `leaf` is lower than the number of leaves
+ */
+void *tournament_get (tournament_t const *p_tree, size_t leaf);
+
+/**
+ * @brief Replace the value of a leaf.
+ *
+ * The worst-case execution time of this function is guaranteed
+ * to be in \f$\log n\f$ where \f$n\f$ is the number of leaves.
+ *
+ * @param p_tree  a pointer to the tournament tree
+ * @param leaf    index of the leaf
+ * @param value   the new value of the leaf - use `NULL` to empty the leaf
+ *
+ * @return  the previous value of the leaf (not deallocated), or `NULL`
+ *
+ * @pre  `p_tree` is not `NULL` and `leaf` is lower than the number of leaves
+ */
+void *tournament_set (tournament_t *p_tree, size_t leaf, void *value);
+
+/** @brief Extract the minimum value in the tournament tree.
+ *
+ * The leaf holding the minimum value is emptied.
+ *
+ * The worst-case execution time of this function is guaranteed
+ * to be in \f$\log n\f$ where \f$n\f$ is the number of leaves.
+ *
+ * @param p_tree  a pointer to the tournament tree
+ * @param leaf    if not `NULL`, filled with the index of the leaf which
+ *                was holding the minimum value
+ *
+ * @return  the minimum value in the tree, or `NULL` if every leaf is empty
+ *
+ * @pre  `p_tree` is not `NULL`
+ */
+void *tournament_extract_min (tournament_t *p_tree, size_t *leaf);
+
+/** @brief Remove every value failing a predicate from the tournament tree.
+ *
+ * The leaves of the removed values are emptied, and the values are not
+ * deallocated: `keep` may deallocate the values it rejects. `keep` may
+ * also change the keys of the values it keeps, which are read again.
+ * Every match is then replayed, so the execution time is in \f$O(n)\f$
+ * where \f$n\f$ is the number of leaves.
+ *
+ * @param p_tree  a pointer to the tournament tree to be filtered
+ * @param keep    the predicate, called once on every value
+ * @param data    data given to every call of `keep`
+ *
+ * @return  the number of removed values
+ *
+ * @pre  `p_tree` is not `NULL`
+ */
+size_t tournament_filter (tournament_t *p_tree, filter_func_t keep, void *data);
+
+/** @brief Deallocate the tournament tree and free the pointer.
+ *
+ * @param p_tree  a pointer to the tournament tree to be deallocated
+ *
+ * @pre  `p_tree` is not `NULL`
+ *
+ * @post  After the call, all memory regions used for the tree
+ *        are deallocated. Values are also deallocated.
+ */
+void tournament_deallocate (tournament_t *p_tree);
+
+#endif
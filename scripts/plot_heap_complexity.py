@@ -6,7 +6,7 @@ import sys
 
 data = np.genfromtxt('data_complexity_heap.csv' if len(sys.argv) == 1 else sys.argv[1],
                      delimiter=',',
-                     names=['nb', 'insert', 'extract'])
+                     names=['nb', 'insert', 'extract', 'bulk'])
 
 fig = plt.figure()
 
@@ -26,6 +26,11 @@ ax2.set_xlabel('# of nodes')
 ax2.set_ylabel('time')
 ax2.plot(data['nb'], data['extract'], c='b', label='extract_min')
 
-leg = ax2.legend()
+# time to insert at once
+ax3 = fig.add_subplot(111)
+
+ax3.plot(data['nb'], data['bulk'], c='g', label='insert_bulk')
+
+leg = ax3.legend()
 
 plt.show()
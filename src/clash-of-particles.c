@@ -1,24 +1,23 @@
 #include "simulation.h"
+#include "snapshot.h"
 #include "disc.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 
-#define MAX_PARTICLES 10000
 #define W_SIZE 900 // windows size
 
-static particle_t *particle_list[MAX_PARTICLES];
-static size_t count;
+static particles_t *particles;
 static void draw_frame(time_t timestamp) {
     assert(NB_DIM==2);
     EmptySpace();
-    for (size_t i = 0; i < count; i++) {
-        particle_t p = *particle_list[i]; // clone particle
-        update(&p, timestamp); // see clone at current time
-        DrawDISC(W_SIZE*p.position[0]/loc_UNIT,
-                 W_SIZE*p.position[1]/loc_UNIT,
-                 W_SIZE*p.radius/loc_UNIT,
+    for (size_t i = 0; i < particles->count; i++) {
+        loc_t position[NB_DIM];
+        particles_position_at(particles, i, timestamp, position); // see particle at current time
+        DrawDISC(W_SIZE*position[0]/loc_UNIT,
+                 W_SIZE*position[1]/loc_UNIT,
+                 W_SIZE*particles->radius[i]/loc_UNIT,
                  1+i%7);
     }
     UpdateScreen();
@@ -26,6 +25,8 @@ static void draw_frame(time_t timestamp) {
 
 int main(int argc, char const *argv[]) {
     FILE *input_file = stdin; // by default, read from standard input
+    size_t count = 0;
+    long double packing_fraction = 0; // random placement if not specified
     if (argc>1) { // if a file is specified, read from it
         char *endptr;
         count = strtol(argv[1], &endptr, 10);
@@ -33,6 +34,13 @@ int main(int argc, char const *argv[]) {
             input_file = stdin;
         } else if (endptr!=NULL && *endptr=='\0') { // number read
             input_file = NULL; // will be generated
+        } else if (endptr!=argv[1] && *endptr=='@') { // number and packing fraction read
+            input_file = NULL; // will be generated on a lattice
+            packing_fraction = strtold(endptr+1, &endptr);
+            if (*endptr!='\0') {
+                fprintf(stderr, "not a valid packing fraction: %s\n", argv[1]);
+                exit(EXIT_FAILURE);
+            }
         } else {
             input_file = fopen(argv[1], "r");
             if (input_file == NULL) {
@@ -56,22 +64,61 @@ int main(int argc, char const *argv[]) {
         }
     }
 
-    if (input_file!=NULL) {
-        count = load_particles(particle_list, MAX_PARTICLES, input_file);
+    simulation_options_t options = SIMULATION_DEFAULT_OPTIONS;
+    if (argc>3) {
+        if (!scheduler_type_parse(argv[3], &options.scheduler)) {
+            fprintf(stderr, "not a valid scheduler: %s\n", argv[3]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (argc>4) {
+        if (!neighbors_type_parse(argv[4], &options.neighbors)) {
+            fprintf(stderr, "not a valid neighbor search: %s\n", argv[4]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (input_file!=NULL && input_file!=stdin && snapshot_check(argv[1])) { // binary snapshot, mapped in memory
         fclose(input_file);
         input_file = NULL;
-    } else
-        generate_particles(particle_list, count, 6502);
+        particles = snapshot_load(argv[1], NULL);
+        if (particles == NULL) {
+            fprintf(stderr, "Cannot read snapshot %s!\n", argv[1]);
+            exit(EXIT_FAILURE);
+        }
+    } else if (input_file!=NULL) {
+        particles = particles_new(0);
+        load_error_t error;
+        if (load_particles(particles, input_file, &error) == 0 && error.reason != NULL) {
+            reader_print_error((input_file==stdin) ? "stdin" : argv[1], &error, stderr);
+            exit(EXIT_FAILURE);
+        }
+        fclose(input_file);
+        input_file = NULL;
+    } else {
+        particles = particles_new(0);
+        if (packing_fraction > 0)
+            generate_packed_particles(particles, count, packing_fraction, 6502);
+        else
+            generate_particles(particles, count, 6502);
+    }
 
     CreateWindow("Gaz gaz gaz", W_SIZE, W_SIZE);
 
-    simulation_loop(particle_list, count, duration*time_UNIT, &draw_frame, 2*time_UNIT);
+    simulation_loop(particles, duration*time_UNIT, &draw_frame, 2*time_UNIT, &options);
 
     CloseWindow();
 
-    for (size_t i = 0; i < count; i++) {
-        free(particle_list[i]);
+    if (argc>5) { // final state, which can be run again
+        FILE *output_file = fopen(argv[5], "wb");
+        if (output_file == NULL || !export_snapshot(particles, output_file, "final state of clash-of-particles")) {
+            fprintf(stderr, "Cannot write snapshot %s!\n", argv[5]);
+            exit(EXIT_FAILURE);
+        }
+        fclose(output_file);
     }
 
+    particles_deallocate(particles);
+
     return 0;
 }
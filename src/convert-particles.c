@@ -0,0 +1,64 @@
+#include "simulation.h"
+#include "snapshot.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static void usage(char const *name) {
+    fprintf(stderr, "Usage :\n");
+    fprintf(stderr, "\t%s input-file output-file\n", name);
+    fprintf(stderr, "\tconvert a text file (see data/) to a binary snapshot, or a binary snapshot to a text file\n");
+}
+
+/* Convert particles between the text and the binary format */
+int main(int argc, char const *argv[]) {
+    if (argc != 3) {
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    bool to_text = snapshot_check(argv[1]);
+    char description[SNAPSHOT_DESCRIPTION_SIZE] = "";
+    particles_t *particles;
+    if (to_text) {
+        particles = snapshot_load(argv[1], description);
+    } else {
+        FILE *input_file = fopen(argv[1], "r");
+        if (input_file == NULL) {
+            fprintf(stderr, "Cannot read file %s!\n", argv[1]);
+            exit(EXIT_FAILURE);
+        }
+        if (fgets(description, sizeof description, input_file) != NULL)
+            description[strcspn(description, "\n")] = '\0';
+        rewind(input_file);
+        particles = particles_new(0);
+        load_error_t error;
+        load_particles(particles, input_file, &error);
+        if (error.reason != NULL) {
+            reader_print_error(argv[1], &error, stderr);
+            exit(EXIT_FAILURE);
+        }
+        fclose(input_file);
+    }
+    if (particles == NULL) {
+        fprintf(stderr, "Cannot load particles from %s!\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    FILE *output_file = fopen(argv[2], to_text ? "w" : "wb");
+    if (output_file == NULL) {
+        fprintf(stderr, "Cannot write file %s!\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+    if (to_text)
+        export_particles(particles, output_file, description);
+    else if (!export_snapshot(particles, output_file, description)) {
+        fprintf(stderr, "Cannot write file %s!\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+    fclose(output_file);
+
+    particles_deallocate(particles);
+
+    return 0;
+}
@@ -0,0 +1,440 @@
+#include "domains.h"
+#include "parallel.h"
+#include "process.h"
+#include <stdlib.h>
+
+typedef struct engine engine_t;
+
+/** @brief A group of slabs advanced by a thread during a window. */
+typedef struct {
+    engine_t           *engine;
+    /** The owned particles, then the ghosts */
+    particles_t        *local;
+    size_t              nb_owned;
+    /** The index in the store of each local particle */
+    size_t             *ids;
+    /** Has each ghost collided with an owned particle? */
+    bool               *touched;
+    /** The position of each owned particle at the start of the window (`NB_DIM` per particle) */
+    loc_t              *start;
+    /** The greatest distance an owned particle moved from its position at the start of the window */
+    loc_t               moved;
+    simulation_stats_t  stats;
+} domain_t;
+
+/** @brief What a worker process receives before the particles of a domain. */
+typedef struct {
+    time_t start;
+    time_t end;
+    size_t count;
+    size_t nb_owned;
+} request_t;
+
+/** @brief What a worker process sends back before the particles of a domain and which ghosts were touched. */
+typedef struct {
+    loc_t              moved;
+    simulation_stats_t stats;
+} reply_t;
+
+struct engine {
+    particles_t          *particles;
+    simulation_options_t  options; // options of the simulation of each domain
+    int                   time_flow;
+    time_t                now; // absolute time, start of the next window
+    time_t                length; // duration of the next window
+    time_t                end; // absolute time, end of the current window
+    loc_t                 reach; // distance a particle may move during a window
+    loc_t                 halo; // distance from a domain up to which particles are ghosts
+    size_t                nb_slabs;
+    size_t               *parent; // slabs merged together, as a union-find forest
+    size_t               *group; // domain of each slab
+    size_t               *mark; // last particle made a ghost of each domain
+    size_t               *owner; // domain owning each particle
+    size_t               *owner_local; // index of each particle in its owner domain
+    domain_t             *domains;
+    size_t                nb_domains;
+    int                  *channels; // channels to the worker processes
+    long                 *pids; // process identifiers of the workers
+    size_t                nb_workers; // number of worker processes, `0` to use threads
+    simulation_stats_t    stats;
+};
+
+
+
+static size_t find(engine_t const *e, size_t s) {
+    while (e->parent[s] != s)
+        s = e->parent[s];
+    return s;
+}
+
+static void merge(engine_t *e, size_t d1, size_t d2) {
+    size_t s1 = 0, s2 = 0;
+    while (e->group[s1] != d1) s1++;
+    while (e->group[s2] != d2) s2++;
+    e->parent[find(e, s1)] = find(e, s2);
+}
+
+static size_t slab_of(engine_t const *e, loc_t x) {
+    loc_t s = floorl(x / loc_UNIT * e->nb_slabs);
+    return (s < 0) ? 0 : (s >= e->nb_slabs) ? e->nb_slabs-1 : (size_t)s;
+}
+
+// measure how far an owned particle moved since the start of the window:
+// its path being straight between collisions, the farthest points are collisions and the end
+static void measure(domain_t *dom, particles_t const *local, size_t i, time_t timestamp) {
+    loc_t position[NB_DIM];
+    particles_position_at(local, i, timestamp, position);
+    loc_t moved = loc_distance(&dom->start[i*NB_DIM], position);
+    if (moved > dom->moved)
+        dom->moved = moved;
+}
+
+// observer of the simulation of a domain
+static void observe(particles_t const *local, size_t a, size_t b, void *data) {
+    domain_t *dom = data;
+    if (a < dom->nb_owned)
+        measure(dom, local, a, local->timestamp[a]);
+    if (b == EVENT_NO_PARTICLE) return;
+    if (b < dom->nb_owned)
+        measure(dom, local, b, local->timestamp[b]);
+    if ((a < dom->nb_owned) != (b < dom->nb_owned))
+        dom->touched[(a < dom->nb_owned) ? b : a] = true;
+}
+
+// advance a domain to the end of the window, keeping the snapshots of its particles as the simulation left them
+static void advance(engine_t const *e, domain_t *dom) {
+    dom->start = malloc(dom->nb_owned * NB_DIM * sizeof *dom->start);
+    for (size_t i = 0; i < dom->nb_owned; i++)
+        particles_position_at(dom->local, i, e->now, &dom->start[i*NB_DIM]);
+    simulation_options_t options = e->options;
+    options.observer = &observe;
+    options.observer_data = dom;
+    options.stats = &dom->stats;
+    simulation_t *sim = simulation_new_at(dom->local, e->time_flow, e->now, &options);
+    simulation_advance_to(sim, e->end);
+    for (size_t i = 0; i < dom->nb_owned; i++)
+        measure(dom, dom->local, i, e->end);
+    particles_t *result = particles_clone(dom->local); // destroying the simulation moves every snapshot
+    simulation_destroy(sim);
+    particles_deallocate(dom->local);
+    dom->local = result;
+    free(dom->start);
+}
+
+// advance the domains of a thread to the end of the window
+static void run(void *data, size_t thread) {
+    engine_t *e = data;
+    size_t nb_threads = (e->options.nb_domains < e->nb_domains) ? e->options.nb_domains : e->nb_domains;
+    for (size_t k = thread; k < e->nb_domains; k += nb_threads)
+        advance(e, &e->domains[k]);
+}
+
+// advance the domains sent by the parent process, until it closes the channel
+static void serve(void *data, size_t worker, int channel) {
+    engine_t *e = data; // a copy of the engine of the parent
+    request_t request;
+    while (process_receive(channel, &request, sizeof request)) {
+        e->now = request.start;
+        e->end = request.end;
+        particle_t *buffer = malloc(request.count * sizeof *buffer);
+        domain_t dom = {e, particles_new(request.count), request.nb_owned, NULL,
+                        calloc(request.count, sizeof *dom.touched), NULL, 0, {0}};
+        bool ok = process_receive(channel, buffer, request.count * sizeof *buffer);
+        if (ok) {
+            for (size_t i = 0; i < request.count; i++)
+                particles_add(dom.local, &buffer[i]);
+            advance(e, &dom);
+            for (size_t i = 0; i < request.count; i++)
+                buffer[i] = particles_get(dom.local, i);
+            reply_t reply = {dom.moved, dom.stats};
+            ok = process_send(channel, &reply, sizeof reply)
+              && process_send(channel, buffer, request.count * sizeof *buffer)
+              && process_send(channel, dom.touched, request.count * sizeof *dom.touched);
+        }
+        particles_deallocate(dom.local);
+        free(dom.touched);
+        free(buffer);
+        if (!ok) break;
+    }
+}
+
+// advance the domains on the worker processes, at most one domain per worker at a time
+static bool run_processes(engine_t *e) {
+    for (size_t first = 0; first < e->nb_domains; first += e->nb_workers) {
+        size_t last = (first + e->nb_workers < e->nb_domains) ? first + e->nb_workers : e->nb_domains;
+        for (size_t k = first; k < last; k++) {
+            domain_t *dom = &e->domains[k];
+            int channel = e->channels[k-first];
+            request_t request = {e->now, e->end, dom->local->count, dom->nb_owned};
+            particle_t *buffer = malloc(request.count * sizeof *buffer);
+            for (size_t i = 0; i < request.count; i++)
+                buffer[i] = particles_get(dom->local, i);
+            bool ok = process_send(channel, &request, sizeof request)
+                   && process_send(channel, buffer, request.count * sizeof *buffer);
+            free(buffer);
+            if (!ok) return false;
+        }
+        for (size_t k = first; k < last; k++) {
+            domain_t *dom = &e->domains[k];
+            int channel = e->channels[k-first];
+            size_t count = dom->local->count;
+            reply_t reply;
+            particle_t *buffer = malloc(count * sizeof *buffer);
+            bool ok = process_receive(channel, &reply, sizeof reply)
+                   && process_receive(channel, buffer, count * sizeof *buffer)
+                   && process_receive(channel, dom->touched, count * sizeof *dom->touched);
+            if (ok) {
+                for (size_t i = 0; i < count; i++)
+                    particles_set(dom->local, i, &buffer[i]);
+                dom->moved = reply.moved;
+                dom->stats = reply.stats;
+            }
+            free(buffer);
+            if (!ok) return false;
+        }
+    }
+    return true;
+}
+
+// copy a particle of the store to a domain
+static size_t add(domain_t *dom, particles_t const *ps, size_t i) {
+    particle_t p = particles_get(ps, i);
+    size_t capacity = dom->local->capacity;
+    size_t k = particles_add(dom->local, &p);
+    if (dom->local->capacity != capacity || dom->ids == NULL)
+        dom->ids = realloc(dom->ids, dom->local->capacity * sizeof *dom->ids);
+    dom->ids[k] = i;
+    return k;
+}
+
+// split the particles into domains, with their ghosts
+static void split(engine_t *e) {
+    particles_t const *ps = e->particles;
+    e->nb_domains = 0;
+    for (size_t s = 0; s < e->nb_slabs; s++)
+        if (find(e, s) == s)
+            e->group[s] = e->nb_domains++;
+    for (size_t s = 0; s < e->nb_slabs; s++)
+        e->group[s] = e->group[find(e, s)];
+    e->domains = malloc(e->nb_domains * sizeof *e->domains);
+    for (size_t k = 0; k < e->nb_domains; k++) {
+        e->domains[k] = (domain_t){e, particles_new(0), 0, NULL, NULL, NULL, 0, {0}};
+        e->mark[k] = (size_t)-1;
+    }
+    // owned particles first
+    size_t *slab = malloc(ps->count * sizeof *slab);
+    loc_t *x = malloc(ps->count * sizeof *x);
+    for (size_t i = 0; i < ps->count; i++) {
+        loc_t position[NB_DIM];
+        particles_position_at(ps, i, e->now, position);
+        x[i] = position[0];
+        slab[i] = slab_of(e, x[i]);
+        domain_t *dom = &e->domains[e->group[slab[i]]];
+        e->owner[i] = e->group[slab[i]];
+        e->owner_local[i] = add(dom, ps, i);
+        dom->nb_owned++;
+    }
+    // then the particles of other domains within the halo
+    loc_t width = (loc_t)loc_UNIT / e->nb_slabs;
+    size_t span = (size_t)ceill(e->halo / width);
+    for (size_t i = 0; i < ps->count; i++) {
+        size_t first = (slab[i] > span) ? slab[i]-span : 0;
+        size_t last = (slab[i]+span < e->nb_slabs) ? slab[i]+span : e->nb_slabs-1;
+        for (size_t s = first; s <= last; s++) {
+            size_t k = e->group[s];
+            if (k == e->owner[i] || e->mark[k] == i) continue;
+            loc_t gap = (s < slab[i]) ? x[i] - (s+1)*width : s*width - x[i];
+            if (gap > e->halo) continue;
+            add(&e->domains[k], ps, i);
+            e->mark[k] = i;
+        }
+    }
+    free(slab);
+    free(x);
+    for (size_t k = 0; k < e->nb_domains; k++)
+        e->domains[k].touched = calloc(e->domains[k].local->count, sizeof *e->domains[k].touched);
+}
+
+// did a ghost go through the same events as the particle it copies?
+static bool same_state(particles_t const *ps1, size_t i1, particles_t const *ps2, size_t i2) {
+    if (ps1->col_counter[i1] != ps2->col_counter[i2] || ps1->timestamp[i1] != ps2->timestamp[i2]) return false;
+    for (size_t d = 0; d < NB_DIM; d++)
+        if (ps1->position[d][i1] != ps2->position[d][i2] || ps1->velocity[d][i1] != ps2->velocity[d][i2])
+            return false;
+    return true;
+}
+
+static void add_stats(simulation_stats_t *total, simulation_stats_t const *part) {
+    total->nb_events        += part->nb_events;
+    total->nb_invalid       += part->nb_invalid;
+    total->nb_crossings     += part->nb_crossings;
+    total->nb_compactions   += part->nb_compactions;
+    total->nb_compacted     += part->nb_compacted;
+    total->compacted_memory += part->compacted_memory;
+    total->startup_time     += part->startup_time;
+    if (part->max_pending > total->max_pending)
+        total->max_pending = part->max_pending;
+    total->pool.nb_allocations += part->pool.nb_allocations;
+    total->pool.nb_recycled    += part->pool.nb_recycled;
+    if (part->pool.max_live > total->pool.max_live)
+        total->pool.max_live = part->pool.max_live;
+    if (part->pool.memory > total->pool.memory)
+        total->pool.memory = part->pool.memory;
+}
+
+static void release(engine_t *e) {
+    for (size_t k = 0; k < e->nb_domains; k++) {
+        particles_deallocate(e->domains[k].local);
+        free(e->domains[k].ids);
+        free(e->domains[k].touched);
+    }
+    free(e->domains);
+}
+
+// run a window up to `end`, and commit it if every domain went through the same events as the serial engine
+static bool window(engine_t *e, time_t end) {
+    particles_t *ps = e->particles;
+    e->end = end;
+    split(e);
+    if (e->nb_workers > 0 && !run_processes(e)) { // a worker died: the domains are run by threads from now on
+        process_join(e->nb_workers, e->channels, e->pids);
+        e->nb_workers = 0;
+        release(e);
+        split(e);
+    }
+    if (e->nb_workers == 0)
+        parallel_run((e->options.nb_domains < e->nb_domains) ? e->options.nb_domains : e->nb_domains, &run, e);
+    loc_t moved = 0;
+    bool conflict = false;
+    for (size_t k = 0; k < e->nb_domains && e->nb_domains > 1; k++) {
+        domain_t *dom = &e->domains[k];
+        if (dom->moved > moved)
+            moved = dom->moved;
+        for (size_t i = dom->nb_owned; i < dom->local->count; i++) {
+            if (!dom->touched[i]) continue;
+            size_t id = dom->ids[i], owner = e->owner[id];
+            if (!same_state(dom->local, i, e->domains[owner].local, e->owner_local[id])) {
+                merge(e, k, owner); // the ghost missed an event of its owner
+                conflict = true;
+            }
+        }
+    }
+    bool strayed = moved > e->reach, commit = !strayed && !conflict;
+    for (size_t k = 0; k < e->nb_domains && commit; k++) {
+        domain_t *dom = &e->domains[k];
+        for (size_t i = 0; i < dom->nb_owned; i++) {
+            particle_t p = particles_get(dom->local, i);
+            particles_set(ps, dom->ids[i], &p);
+        }
+        add_stats(&e->stats, &dom->stats);
+    }
+    release(e);
+    if (strayed) { // particles moved too far for the halo
+        e->length /= 2;
+        conflict = false;
+        for (size_t s = 0; s < e->nb_slabs; s++) // merges may not be needed in a shorter window
+            e->parent[s] = s;
+    }
+    if (!commit) {
+        e->stats.nb_rollbacks++;
+        return false;
+    }
+    e->stats.nb_windows++;
+    e->now = end;
+    // the next window is as long as particles may move, within the growth allowed
+    e->length *= (moved*DOMAINS_GROWTH > e->reach) ? e->reach/moved : DOMAINS_GROWTH;
+    for (size_t s = 0; s < e->nb_slabs; s++)
+        e->parent[s] = s;
+    return true;
+}
+
+// run windows up to an absolute time
+static void advance_to(engine_t *e, time_t timestamp) {
+    int time_flow = e->time_flow;
+    while (IS_BEFORE(e->now*time_flow, timestamp*time_flow)) {
+        time_t end = e->now + e->length*time_flow;
+        if (IS_BEFORE(timestamp*time_flow, end*time_flow))
+            end = timestamp;
+        if (!IS_BEFORE(e->now*time_flow, end*time_flow)) { // too short to advance: a single domain up to the target
+            for (size_t s = 0; s < e->nb_slabs; s++)
+                e->parent[s] = 0;
+            end = timestamp;
+            e->length = (end - e->now)*time_flow;
+        }
+        window(e, end);
+    }
+}
+
+
+
+void
+domains_loop(particles_t *particles, time_t duration, void (*callback)(time_t timestamp), time_t callback_rate, simulation_options_t const *options)
+{
+    loc_t max_radius = 0;
+    for (size_t i = 0; i < particles->count; i++)
+        if (particles->radius[i] > max_radius)
+            max_radius = particles->radius[i];
+    if (max_radius == 0) { // the reach would be empty, and windows would not advance: use the serial engine
+        simulation_options_t serial = *options;
+        serial.nb_domains = 0;
+        simulation_loop(particles, duration, callback, callback_rate, &serial);
+        return;
+    }
+    int time_flow = (duration<0) ? -1 : 1;
+    size_t nb_slabs = options->nb_domains;
+    engine_t e = {particles, *options, time_flow, 0, 0, 0, 0, 0, nb_slabs,
+                  malloc(nb_slabs * sizeof *e.parent), malloc(nb_slabs * sizeof *e.group),
+                  malloc(nb_slabs * sizeof *e.mark), malloc(particles->count * sizeof *e.owner),
+                  malloc(particles->count * sizeof *e.owner_local), NULL, 0, NULL, NULL, 0, {0}};
+    e.options.epoch_period = 0; // windows are given absolute times
+    e.options.stats = NULL;
+    e.options.nb_threads = 0; // domains are already run in parallel
+    loc_t max_speed = 0;
+    for (size_t i = 0; i < particles->count; i++) {
+        if (i == 0 || IS_BEFORE(particles->timestamp[i]*time_flow, e.now*time_flow)) // start from the oldest snapshot
+            e.now = particles->timestamp[i];
+        loc_t velocity[NB_DIM];
+        for (size_t d = 0; d < NB_DIM; d++)
+            velocity[d] = particles->velocity[d][i];
+        loc_t speed = sqrtl(loc_scal_prod(velocity, velocity));
+        if (speed > max_speed)
+            max_speed = speed;
+    }
+    // the partner of an owned particle started at most twice the reach and two radii away
+    e.reach = DOMAINS_REACH*max_radius;
+    e.halo = 2*(e.reach + max_radius);
+    e.length = (max_speed > 0) ? e.reach / max_speed * time_UNIT : INFINITY;
+    for (size_t s = 0; s < nb_slabs; s++)
+        e.parent[s] = s;
+    if (options->domain_processes) { // one worker per slab, or threads if none can be started
+        e.channels = malloc(nb_slabs * sizeof *e.channels);
+        e.pids = malloc(nb_slabs * sizeof *e.pids);
+        e.nb_workers = process_spawn(nb_slabs, &serve, &e, e.channels, e.pids);
+    }
+
+    if (callback_rate<0)
+        callback_rate *= -1;
+    if (!EQ_TIME_ZERO(callback_rate)) // a callback every `callback_rate`, from time zero
+        for (time_t t = 0; !IS_BEFORE(duration*time_flow, t); t += callback_rate) {
+            advance_to(&e, t*time_flow);
+            (*callback)(t*time_flow);
+        }
+    advance_to(&e, duration);
+
+    // set particles position at the end, as absolute snapshots.
+    time_t now = IS_BEFORE(e.now*time_flow, duration*time_flow) ? duration : e.now;
+    for (size_t i = 0; i < particles->count; i++) {
+        update(particles, i, now);
+        particles->timestamp[i] = now;
+    }
+    if (options->stats != NULL)
+        *options->stats = e.stats;
+    process_join(e.nb_workers, e.channels, e.pids);
+    free(e.channels);
+    free(e.pids);
+    free(e.parent);
+    free(e.group);
+    free(e.mark);
+    free(e.owner);
+    free(e.owner_local);
+}
@@ -1,12 +1,166 @@
+#define _POSIX_C_SOURCE 200112L
 #include "event.h"
 #include <stdlib.h>
+#include <string.h>
+
+/** @brief Number of events carved out of each chunk of a pool. */
+#define EVENT_POOL_CHUNK 4096
+
+/** @brief An alias to the structure representing a chunk of events. */
+typedef struct event_chunk event_chunk_t;
+
+/** @brief The structure representing a chunk of events. */
+struct event_chunk {
+    /** The previous chunk of the pool */
+    event_chunk_t *previous;
+    /** The events of the chunk */
+    event_t        events[EVENT_POOL_CHUNK];
+#ifndef DOUBLE_PRECISION
+    /** The times of the events of the chunk, more precise than their keys */
+    time_t         times[EVENT_POOL_CHUNK];
+#endif
+};
+
+// smallest power of two holding a chunk: chunks are aligned on it, so that the chunk of an event is found from its address
+static size_t chunk_alignment(void) {
+    size_t alignment = 1;
+    while (alignment < sizeof(event_chunk_t))
+        alignment <<= 1;
+    return alignment;
+}
+
+#ifndef DOUBLE_PRECISION
+// precise time of an event, kept by the chunk holding the event
+static time_t *time_of(event_t const *e) {
+    event_chunk_t *chunk = (event_chunk_t *)((uintptr_t)e & ~(uintptr_t)(chunk_alignment()-1));
+    return &chunk->times[e - chunk->events];
+}
+#endif
+
+/** @brief An alias to the structure representing a released event. */
+typedef union free_event free_event_t;
+
+/** @brief The structure representing a released event, waiting to be recycled. */
+union free_event {
+    /** The next released event */
+    free_event_t *next;
+    /** The memory of the event */
+    event_t       event;
+};
+
+struct event_pool {
+    /** The last chunk allocated, may be `NULL` */
+    event_chunk_t     *chunks;
+    /** The number of events of the last chunk which were never allocated */
+    size_t             nb_unused;
+    /** The released events, may be `NULL` */
+    free_event_t      *free_list;
+    /** The counters of the pool */
+    event_pool_stats_t stats;
+};
+
+// allocate an event from the pool
+static event_t *event_alloc(event_pool_t *pool) {
+    event_t *event;
+    pool->stats.nb_allocations++;
+    if (pool->free_list != NULL) { // recycle a released event
+        event = &pool->free_list->event;
+        pool->free_list = pool->free_list->next;
+        pool->stats.nb_recycled++;
+    } else {
+        if (pool->nb_unused == 0) { // carve a new chunk
+            void *memory;
+            event_chunk_t *chunk = (posix_memalign(&memory, chunk_alignment(), sizeof *chunk) == 0) ? memory : NULL;
+            chunk->previous = pool->chunks;
+            pool->chunks = chunk;
+            pool->nb_unused = EVENT_POOL_CHUNK;
+            pool->stats.memory += sizeof *chunk;
+        }
+        event = &pool->chunks->events[EVENT_POOL_CHUNK - pool->nb_unused--];
+    }
+    if (++pool->stats.nb_live > pool->stats.max_live)
+        pool->stats.max_live = pool->stats.nb_live;
+    return event;
+}
+
+event_pool_t *
+event_pool_new(void)
+{
+    event_pool_t *pool = malloc(sizeof *pool);
+    *pool = (event_pool_t){NULL, 0, NULL, {0, 0, 0, 0, sizeof *pool}};
+    return pool;
+}
+
+event_pool_stats_t
+event_pool_stats(event_pool_t const *pool)
+{
+    return pool->stats;
+}
+
+void
+event_pool_deallocate(event_pool_t *pool)
+{
+    while (pool->chunks != NULL) {
+        event_chunk_t *previous = pool->chunks->previous;
+        free(pool->chunks);
+        pool->chunks = previous;
+    }
+    free(pool);
+}
+
+void
+event_release(event_pool_t *pool, event_t *e)
+{
+    if (e == NULL) return;
+    free_event_t *released = (free_event_t *)e;
+    released->next = pool->free_list;
+    pool->free_list = released;
+    pool->stats.nb_live--;
+}
+
+event_key_t
+event_key(time_t timestamp)
+{
+    double t = timestamp;
+    event_key_t bits;
+    memcpy(&bits, &t, sizeof bits);
+    // flip negative values entirely, and the sign bit of positive ones
+    return (bits >> 63) ? ~bits : bits | (UINT64_C(1) << 63);
+}
+
+time_t
+event_timestamp(event_t const *e)
+{
+#ifndef DOUBLE_PRECISION
+    return *time_of(e);
+#else
+    event_key_t bits = (e->key >> 63) ? e->key & ~(UINT64_C(1) << 63) : ~e->key;
+    double t;
+    memcpy(&t, &bits, sizeof t);
+    return t;
+#endif
+}
+
+// time an event, keeping the time itself when the key rounds it
+static void set_timestamp(event_t *e, time_t timestamp) {
+    e->key = event_key(timestamp);
+#ifndef DOUBLE_PRECISION
+    *time_of(e) = timestamp;
+#endif
+}
+
+void
+event_shift(event_t *e, time_t shift)
+{
+    set_timestamp(e, event_timestamp(e) - shift);
+}
 
 bool
-event_is_valid(event_t *e)
+event_is_valid(event_t const *e, particles_t const *ps)
 {
-    if (e->particle_a != NULL && e->particle_a->col_counter != e->particle_a_col)
+    if (e->particle_a != EVENT_NO_PARTICLE && (uint32_t)ps->col_counter[e->particle_a] != e->particle_a_col)
         return false;
-    if (e->particle_b != NULL && e->particle_b->col_counter != e->particle_b_col)
+    if (e->particle_b != EVENT_NO_PARTICLE && (uint32_t)ps->col_counter[e->particle_b] != e->particle_b_col)
         return false;
     return true;
 }
@@ -16,60 +170,62 @@ compare_events(void *event1, void *event2)
 {
     event_t *e1 = event1;
     event_t *e2 = event2;
-    return (IS_BEFORE(e1->timestamp, e2->timestamp)) ? -1 :
-           (IS_BEFORE(e2->timestamp, e1->timestamp)) ?  1 :
-                                                        0 ;
+    if (e1->key != e2->key)
+        return (e1->key < e2->key) ? -1 : 1;
+    time_t t1 = event_timestamp(e1);
+    time_t t2 = event_timestamp(e2);
+    return (t1 < t2) ? -1 :
+           (t1 > t2) ?  1 :
+                        0 ;
 }
 
 
 enum event_type
-get_event_type(event_t *e)
+get_event_type(event_t const *e)
 {
-    if (e->particle_a != NULL) {
-        if (e->particle_b != NULL)
+    if (e->particle_a != EVENT_NO_PARTICLE) {
+        if (e->particle_b != EVENT_NO_PARTICLE)
             return EVENT_COLLIDE_PARTICLE;
+        else if (e->particle_b_col >= NB_DIM)
+            return EVENT_CROSS_CELL;
         else
             return EVENT_COLLIDE_HPLANE;
-    } else {
-        if (e->particle_b != NULL)
-            return EVENT_COLLIDE_HPLANE; // non standard
-        else
-            return EVENT_REFRESH;
     }
+    return EVENT_COLLIDE_HPLANE; // non standard
 }
 
 event_t *
-event_collide_particle(time_t timestamp, particle_t *p1, particle_t *p2)
+event_collide_particle(event_pool_t *pool, time_t timestamp, particles_t const *ps, size_t a, size_t b)
 {
-    event_t *event = malloc(sizeof *event);
-    event->timestamp = timestamp;
-    event->particle_a = p1;
-    event->particle_a_col = p1->col_counter;
-    event->particle_b = p2;
-    event->particle_b_col = p2->col_counter;
+    event_t *event = event_alloc(pool);
+    set_timestamp(event, timestamp);
+    event->particle_a = a;
+    event->particle_a_col = ps->col_counter[a];
+    event->particle_b = b;
+    event->particle_b_col = ps->col_counter[b];
     return event;
 }
 
 event_t *
-event_collide_hplane(time_t timestamp, particle_t *p, size_t dim)
+event_collide_hplane(event_pool_t *pool, time_t timestamp, particles_t const *ps, size_t a, size_t dim)
 {
-    event_t *event = malloc(sizeof *event);
-    event->timestamp = timestamp;
-    event->particle_a = p;
-    event->particle_a_col = p->col_counter;
-    event->particle_b = NULL;
+    event_t *event = event_alloc(pool);
+    set_timestamp(event, timestamp);
+    event->particle_a = a;
+    event->particle_a_col = ps->col_counter[a];
+    event->particle_b = EVENT_NO_PARTICLE;
     event->particle_b_col = dim;
     return event;
 }
 
 event_t *
-event_refresh(time_t timestamp)
+event_cross_cell(event_pool_t *pool, time_t timestamp, particles_t const *ps, size_t a, size_t dim)
 {
-    event_t *event = malloc(sizeof *event);
-    event->timestamp = timestamp;
-    event->particle_a = NULL;
-    event->particle_a_col = 0;
-    event->particle_b = NULL;
-    event->particle_b_col = 0;
+    event_t *event = event_alloc(pool);
+    set_timestamp(event, timestamp);
+    event->particle_a = a;
+    event->particle_a_col = ps->col_counter[a];
+    event->particle_b = EVENT_NO_PARTICLE;
+    event->particle_b_col = NB_DIM + dim;
     return event;
 }
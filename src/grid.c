@@ -0,0 +1,171 @@
+#include "grid.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+/** @brief Marker of the end of the list of particles of a cell. */
+#define NO_PARTICLE ((size_t)-1)
+
+struct grid {
+    /** The number of cells along each dimention */
+    size_t  width;
+    /** The width of a cell */
+    loc_t   cell_width;
+    /** The first particle of each cell, or `NO_PARTICLE` */
+    size_t *heads;
+    /** The next particle in the cell of each particle, or `NO_PARTICLE` */
+    size_t *next;
+    /** The previous particle in the cell of each particle, or `NO_PARTICLE` */
+    size_t *prev;
+    /** The coordinates of the cell of each particle (`NB_DIM` per particle) */
+    size_t *coords;
+    /** The indexes returned by the last neighbors query */
+    size_t *buffer;
+    /** The number of cells allocated in `buffer` */
+    size_t  buffer_capacity;
+};
+
+
+
+// index of the cell of a particle
+static size_t cell_of(grid_t const *g, size_t i) {
+    size_t cell = 0;
+    for (size_t d = NB_DIM; d-- > 0;)
+        cell = cell*g->width + g->coords[i*NB_DIM+d];
+    return cell;
+}
+
+static void cell_link(grid_t *g, size_t i) {
+    size_t cell = cell_of(g, i);
+    g->prev[i] = NO_PARTICLE;
+    g->next[i] = g->heads[cell];
+    if (g->heads[cell] != NO_PARTICLE)
+        g->prev[g->heads[cell]] = i;
+    g->heads[cell] = i;
+}
+
+static void cell_unlink(grid_t *g, size_t i) {
+    if (g->prev[i] != NO_PARTICLE)
+        g->next[g->prev[i]] = g->next[i];
+    else
+        g->heads[cell_of(g, i)] = g->next[i];
+    if (g->next[i] != NO_PARTICLE)
+        g->prev[g->next[i]] = g->prev[i];
+}
+
+static void push(grid_t *g, size_t *count, size_t j) {
+    if (*count == g->buffer_capacity) {
+        g->buffer_capacity = (g->buffer_capacity==0) ? 64 : 2*g->buffer_capacity;
+        g->buffer = realloc(g->buffer, g->buffer_capacity * sizeof *g->buffer);
+    }
+    g->buffer[(*count)++] = j;
+}
+
+// gather the particles of the cells at offsets {-1,0,1}^NB_DIM from the cell of i,
+// only keeping offset `dir` along `fixed_dim` (no restriction if `fixed_dim>=NB_DIM`)
+static size_t collect(grid_t *g, size_t i, size_t fixed_dim, int dir) {
+    size_t count = 0;
+    size_t nb_offsets = 1;
+    for (size_t d = 0; d < NB_DIM; d++)
+        nb_offsets *= 3;
+    for (size_t k = 0; k < nb_offsets; k++) {
+        size_t cell = 0;
+        size_t stride = 1;
+        size_t code = k;
+        bool inside = true;
+        for (size_t d = 0; d < NB_DIM && inside; d++, code /= 3, stride *= g->width) {
+            int offset = (int)(code%3) - 1;
+            long c = (long)g->coords[i*NB_DIM+d] + offset;
+            inside = (d != fixed_dim || offset == dir) && c >= 0 && c < (long)g->width;
+            cell += c*stride;
+        }
+        if (!inside) continue;
+        for (size_t j = g->heads[cell]; j != NO_PARTICLE; j = g->next[j])
+            push(g, &count, j);
+    }
+    return count;
+}
+
+grid_t *
+grid_new(size_t nb_part, loc_t min_width)
+{
+    size_t max_cells = (nb_part > 0) ? 2*nb_part : 1; // do not waste memory on empty cells
+    loc_t width = floorl(powl(max_cells, 1.L/NB_DIM) + 1e-9L);
+    if (min_width > 0 && loc_UNIT / min_width < width)
+        width = floorl(loc_UNIT / min_width);
+    size_t w = (width >= 1) ? (size_t)width : 1;
+    size_t nb_cells = 1;
+    for (size_t d = 0; d < NB_DIM; d++)
+        nb_cells *= w;
+
+    grid_t *g = malloc(sizeof *g);
+    *g = (grid_t){w, loc_UNIT/w,
+                  malloc(nb_cells * sizeof *g->heads),
+                  malloc(nb_part * sizeof *g->next),
+                  malloc(nb_part * sizeof *g->prev),
+                  malloc(nb_part * NB_DIM * sizeof *g->coords),
+                  NULL, 0};
+    for (size_t c = 0; c < nb_cells; c++)
+        g->heads[c] = NO_PARTICLE;
+    return g;
+}
+
+void
+grid_insert(grid_t *g, size_t i, loc_t const position[NB_DIM])
+{
+    for (size_t d = 0; d < NB_DIM; d++) {
+        loc_t c = floorl(position[d] / g->cell_width);
+        g->coords[i*NB_DIM+d] = (c < 0) ? 0 : (c >= g->width) ? g->width-1 : (size_t)c;
+    }
+    cell_link(g, i);
+}
+
+void
+grid_remove(grid_t *g, size_t i)
+{
+    cell_unlink(g, i);
+}
+
+void
+grid_move(grid_t *g, size_t i, size_t dim, int dir)
+{
+    size_t c = g->coords[i*NB_DIM+dim];
+    if ((dir < 0 && c == 0) || (dir > 0 && c+1 >= g->width)) return;
+    cell_unlink(g, i);
+    g->coords[i*NB_DIM+dim] = c + dir;
+    cell_link(g, i);
+}
+
+loc_t
+grid_face(grid_t const *g, size_t i, size_t dim, int dir)
+{
+    size_t c = g->coords[i*NB_DIM+dim];
+    if (dir > 0)
+        return (c+1 >= g->width) ? NEVER : (c+1)*g->cell_width;
+    else
+        return (c == 0) ? NEVER : c*g->cell_width;
+}
+
+size_t const *
+grid_neighbors(grid_t *g, size_t i, size_t *count)
+{
+    *count = collect(g, i, NB_DIM, 0);
+    return g->buffer;
+}
+
+size_t const *
+grid_new_neighbors(grid_t *g, size_t i, size_t dim, int dir, size_t *count)
+{
+    *count = collect(g, i, dim, dir);
+    return g->buffer;
+}
+
+void
+grid_deallocate(grid_t *g)
+{
+    free(g->heads);
+    free(g->next);
+    free(g->prev);
+    free(g->coords);
+    free(g->buffer);
+    free(g);
+}
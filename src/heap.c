@@ -1,108 +1,120 @@
 #include "heap.h"
 #include <stdlib.h>
+#include <string.h>
 
-/** @brief An alias to the structure representing the nodes of the binary heap. */
-typedef struct heap_node heap_node_t;
-
-/** @brief The structure representing the nodes of the binary heap. */
-struct heap_node {
-    /** The value in the node */
-    void        *value;
-    /** A pointer to the left child node */
-    heap_node_t *left;
-    /** A pointer to the right child node */
-    heap_node_t *right;
-    /** A pointer to the father node */
-    heap_node_t *father;
-};
+/** @brief Minimal number of cells allocated for the values of a non-empty heap. */
+#define HEAP_MIN_CAPACITY 16
 
 struct heap {
-    /** The root of the binary heap. May be `NULL` */
-    heap_node_t   *root;
+    /** The values of the binary heap, stored as an implicit tree:
+     *  children of cell `i` are cells `2i+1` and `2i+2`. May be `NULL` */
+    void         **values;
+    /** The keys of the values, stored in the same cells as the values.
+     *  `NULL` if the heap uses a comparator */
+    heap_key_t    *keys;
     /** The size of the binary heap */
     size_t         size;
-    /** The comparator function used by the elements */
+    /** The number of cells allocated in `values` */
+    size_t         capacity;
+    /** The comparator function used by the elements, `NULL` for a keyed heap */
     compare_func_t comparator;
+    /** The offset of the key inside the values of a keyed heap */
+    size_t         key_offset;
+    /** The comparator breaking ties between equal keys of a keyed heap, may be `NULL` */
+    compare_func_t tie;
     /** The operator function used at deallocation */
     operate_func_t deallocate_value;
 };
 
 
 
-// // auxiliary functions
-// void print_level(heap_node_t *p_node, int level, int size, int path) {
-//     if (path>size) {
-//         if (path<=1) printf("nil\n");
-//         return;
-//     }
-//
-//     for (int i = level-1; i > 0; i--) {
-//         printf(" %c ", ((path>>i&1)==0) ? '|':' ');
-//     }
-//
-//     if (p_node == NULL) {
-//         printf("%snil\n", level == 0 ? "" : " +-");
-//         return;
-//     }
-//
-//     printf("%s(%d)\n", level == 0 ? "" : " +-", p_node->value);
-//     print_level(p_node->left,  level+1, size, (path<<1)+0);
-//     print_level(p_node->right, level+1, size, (path<<1)+1);
-// }
-
-static heap_node_t **get_child(heap_node_t *father, int index) {
-    return ((index & 0x1) == 0x0) ? &father->left : &father->right;
+// index arithmetic of the implicit tree
+#define FATHER(i) (((i)-1)>>1)
+#define LEFT(i)   (((i)<<1)+1)
+
+// resize the array of values, keeping the values in place
+static void resize(heap_t *p_heap, size_t capacity) {
+    p_heap->values = realloc(p_heap->values, capacity * sizeof *p_heap->values);
+    if (p_heap->comparator == NULL)
+        p_heap->keys = realloc(p_heap->keys, capacity * sizeof *p_heap->keys);
+    p_heap->capacity = capacity;
 }
 
-// gives a pointer to the heap node representing the
-// node number n (starting from 0) in the heap
-static heap_node_t *go_to_node(heap_t *p_heap, int n) {
-    n++;
-    int level=0;
-    while (n>>level != 0x1)
-        level++;
-    heap_node_t *father = p_heap->root;
-    while (--level>=0) {
-        father = *get_child(father, n>>level);
-    }
-    return father;
+// key embedded in a value, only meaningful for a keyed heap
+static heap_key_t key_of(heap_t const *p_heap, void const *value) {
+    heap_key_t key = 0;
+    if (p_heap->comparator != NULL) return key;
+    memcpy(&key, (char const *)value + p_heap->key_offset, sizeof key);
+    return key;
 }
 
-// switch this node with his parent
-static heap_node_t *ascend_node(heap_node_t *node) {
-    void *value = node->value;
-    node->value = node->father->value;
-    node->father->value = value;
-    return node->father;
+// is (k1,v1) extracted before (k2,v2) from a keyed heap
+static bool keyed_before(heap_t const *p_heap, heap_key_t k1, void *v1, heap_key_t k2, void *v2) {
+    return k1 < k2 || (k1 == k2 && p_heap->tie != NULL && (*p_heap->tie)(v1, v2) < 0);
 }
 
-static void ascend_while_possible(heap_node_t *node, compare_func_t comparator) {
-    while (node->father != NULL && (*comparator)(node->value, node->father->value) < 0)
-        node = ascend_node(node);
+// move the hole at index i up until value can be put in it (key is ignored if a comparator is used)
+static void ascend_while_possible(heap_t *p_heap, size_t i, void *value, heap_key_t key) {
+    void **values = p_heap->values;
+    compare_func_t comparator = p_heap->comparator;
+    if (comparator == NULL) {
+        heap_key_t *keys = p_heap->keys;
+        while (i > 0 && keyed_before(p_heap, key, value, keys[FATHER(i)], values[FATHER(i)])) {
+            values[i] = values[FATHER(i)];
+            keys[i] = keys[FATHER(i)];
+            i = FATHER(i);
+        }
+        keys[i] = key;
+    } else {
+        while (i > 0 && (*comparator)(value, values[FATHER(i)]) < 0) {
+            values[i] = values[FATHER(i)];
+            i = FATHER(i);
+        }
+    }
+    values[i] = value;
 }
 
-static void descend_while_possible(heap_node_t *node, compare_func_t comparator) {
-    for (;;) {
-        void *min = node->value;
-        heap_node_t *child = NULL; // itself
-        heap_node_t *c;
-        for (int i=0; i<2; i++) {
-            if ((c=*get_child(node, i))==NULL || c->value==NULL) continue;
-            if ((*comparator)(c->value, min) >= 0) continue;
-            child = c;
-            min = child->value;
+// move the hole at index i down until value can be put in it (key is ignored if a comparator is used)
+static void descend_while_possible(heap_t *p_heap, size_t i, void *value, heap_key_t key) {
+    void **values = p_heap->values;
+    compare_func_t comparator = p_heap->comparator;
+    size_t size = p_heap->size;
+    size_t c;
+    if (comparator == NULL) {
+        heap_key_t *keys = p_heap->keys;
+        while ((c=LEFT(i)) < size) {
+            if (c+1 < size && keyed_before(p_heap, keys[c+1], values[c+1], keys[c], values[c]))
+                c++; // smallest child
+            if (!keyed_before(p_heap, keys[c], values[c], key, value))
+                break;
+            values[i] = values[c];
+            keys[i] = keys[c];
+            i = c;
+        }
+        keys[i] = key;
+    } else {
+        while ((c=LEFT(i)) < size) {
+            if (c+1 < size && (*comparator)(values[c+1], values[c]) < 0)
+                c++; // smallest child
+            if ((*comparator)(values[c], value) >= 0)
+                break;
+            values[i] = values[c];
+            i = c;
         }
-        if (child==NULL)
-            break;
-        ascend_node(child);
-        node = child;
     }
+    values[i] = value;
 }
 
 // functions from the signature
 heap_t *heap_new(compare_func_t comparator, operate_func_t deallocate_value) {
     heap_t *ans = malloc(sizeof *ans);
-    *ans = (heap_t){NULL, 0, comparator, deallocate_value};
+    *ans = (heap_t){NULL, NULL, 0, 0, comparator, 0, NULL, deallocate_value};
+    return ans;
+}
+
+heap_t *heap_new_keyed(size_t key_offset, compare_func_t tie, operate_func_t deallocate_value) {
+    heap_t *ans = malloc(sizeof *ans);
+    *ans = (heap_t){NULL, NULL, 0, 0, NULL, key_offset, tie, deallocate_value};
     return ans;
 }
 
@@ -110,46 +122,78 @@ bool heap_is_empty(heap_t const *p_heap) {
     return p_heap->size == 0;
 }
 
+size_t heap_size(heap_t const *p_heap) {
+    return p_heap->size;
+}
+
 void heap_insert(heap_t *p_heap, void *value) {
     if (value==NULL) return;
-    heap_node_t **node_cell;
-    heap_node_t node = {value, NULL, NULL, NULL};
-    if (p_heap->size++ == 0) {
-        node_cell = &p_heap->root;
-    } else {
-        node.father = go_to_node(p_heap, ((p_heap->size)>>1)-1);
-        node_cell = get_child(node.father, p_heap->size);
+    if (p_heap->size == p_heap->capacity) // amortized growth
+        resize(p_heap, (p_heap->capacity==0) ? HEAP_MIN_CAPACITY : 2*p_heap->capacity);
+    ascend_while_possible(p_heap, p_heap->size++, value, key_of(p_heap, value));
+}
+
+void heap_insert_bulk(heap_t *p_heap, void *values[], size_t count) {
+    size_t size = p_heap->size;
+    size_t capacity = (p_heap->capacity==0) ? HEAP_MIN_CAPACITY : p_heap->capacity;
+    while (capacity < size+count)
+        capacity *= 2;
+    if (capacity != p_heap->capacity)
+        resize(p_heap, capacity);
+    size_t added = 0;
+    for (size_t i = 0; i < count; i++)
+        if (values[i] != NULL)
+            p_heap->values[size+added++] = values[i];
+    if (added < size) { // few values: insert them one by one
+        for (size_t i = size; i < size+added; i++)
+            ascend_while_possible(p_heap, p_heap->size++, p_heap->values[i], key_of(p_heap, p_heap->values[i]));
+        return;
     }
-    if (*node_cell == NULL) {
-        *node_cell = malloc(sizeof **node_cell);
-        **node_cell = node;
-    } else // use allocated node again
-        (*node_cell)->value = node.value; // keep children
-    ascend_while_possible(*node_cell, p_heap->comparator);
+    p_heap->size = size+added; // many values: heapify bottom-up
+    if (p_heap->comparator == NULL)
+        for (size_t i = size; i < p_heap->size; i++)
+            p_heap->keys[i] = key_of(p_heap, p_heap->values[i]);
+    for (size_t i = p_heap->size/2; i-- > 0;)
+        descend_while_possible(p_heap, i, p_heap->values[i], (p_heap->comparator == NULL) ? p_heap->keys[i] : 0);
 }
 
 void *heap_extract_min(heap_t *p_heap) {
     if (p_heap->size == 0) return NULL;
-    void *ans = p_heap->root->value;
-    heap_node_t *node = go_to_node(p_heap, --p_heap->size);
-    p_heap->root->value = node->value;
-    node->value = NULL; // no need to deallocate each time an element is extracted
-    descend_while_possible(p_heap->root, p_heap->comparator);
+    void *ans = p_heap->values[0];
+    void *last = p_heap->values[--p_heap->size];
+    if (p_heap->size > 0)
+        descend_while_possible(p_heap, 0, last, (p_heap->comparator == NULL) ? p_heap->keys[p_heap->size] : 0);
+    if (p_heap->capacity > HEAP_MIN_CAPACITY && p_heap->size <= p_heap->capacity/4)
+        resize(p_heap, p_heap->capacity/2); // amortized shrink, keeping room to grow again
     return ans;
 }
 
-// void print_heap(heap_t *p_heap) {
-//     print_level(p_heap->root, 0, p_heap->size, 1);
-// }
-
-static void deallocate_node(heap_node_t *node, operate_func_t deallocate_value) {
-    if (node==NULL) return;
-    for (int i=0; i<2; i++) deallocate_node(*get_child(node, i), deallocate_value);
-    if (deallocate_value!=NULL && node->value!=NULL) (*deallocate_value)(node->value);
-    free(node);
+size_t heap_filter(heap_t *p_heap, filter_func_t keep, void *data) {
+    size_t size = 0;
+    for (size_t i = 0; i < p_heap->size; i++) {
+        if (!(*keep)(p_heap->values[i], data)) continue;
+        p_heap->values[size] = p_heap->values[i];
+        if (p_heap->comparator == NULL)
+            p_heap->keys[size] = key_of(p_heap, p_heap->values[i]); // keep may have changed it
+        size++;
+    }
+    size_t removed = p_heap->size - size;
+    p_heap->size = size;
+    for (size_t i = size/2; i-- > 0;) // heapify bottom-up
+        descend_while_possible(p_heap, i, p_heap->values[i], (p_heap->comparator == NULL) ? p_heap->keys[i] : 0);
+    size_t capacity = p_heap->capacity;
+    while (capacity > HEAP_MIN_CAPACITY && size <= capacity/4)
+        capacity /= 2; // same shrink as extractions
+    if (capacity != p_heap->capacity)
+        resize(p_heap, capacity);
+    return removed;
 }
 
 void heap_deallocate(heap_t *p_heap) {
-    deallocate_node(p_heap->root, p_heap->deallocate_value);
+    if (p_heap->deallocate_value!=NULL)
+        for (size_t i = 0; i < p_heap->size; i++)
+            (*p_heap->deallocate_value)(p_heap->values[i]);
+    free(p_heap->values);
+    free(p_heap->keys);
     free(p_heap);
 }
@@ -0,0 +1,240 @@
+#include "hgrid.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+/** @brief Marker of the end of the list of particles of a cell. */
+#define NO_PARTICLE ((size_t)-1)
+
+/** @brief Maximal number of levels: cells of the last one are at least \f$2^{31}\f$ times wider. */
+#define HGRID_MAX_LEVELS 32
+
+/** @brief A level of the hierarchical grid: a uniform grid. */
+typedef struct {
+    /** The number of cells along each dimention */
+    size_t  width;
+    /** The width of a cell */
+    loc_t   cell_width;
+    /** The radius of the biggest particle registered at this level */
+    loc_t   max_radius;
+    /** The number of particles registered at this level */
+    size_t  nb_part;
+    /** The first particle of each cell, or `NO_PARTICLE` */
+    size_t *heads;
+} level_t;
+
+struct hgrid {
+    /** The number of levels */
+    size_t   nb_levels;
+    /** The levels, from the finest to the coarsest */
+    level_t  levels[HGRID_MAX_LEVELS];
+    /** The level of each particle */
+    size_t  *level;
+    /** The radius of each particle */
+    loc_t   *radius;
+    /** The next particle in the cell of each particle, or `NO_PARTICLE` */
+    size_t  *next;
+    /** The previous particle in the cell of each particle, or `NO_PARTICLE` */
+    size_t  *prev;
+    /** The coordinates of the cell of each particle, at its level (`NB_DIM` per particle) */
+    size_t  *coords;
+    /** The indexes returned by the last neighbors query */
+    size_t  *buffer;
+    /** The number of cells allocated in `buffer` */
+    size_t   buffer_capacity;
+};
+
+
+
+// index of the cell of a particle, at its level
+static size_t cell_of(hgrid_t const *g, size_t i) {
+    size_t width = g->levels[g->level[i]].width;
+    size_t cell = 0;
+    for (size_t d = NB_DIM; d-- > 0;)
+        cell = cell*width + g->coords[i*NB_DIM+d];
+    return cell;
+}
+
+static void cell_link(hgrid_t *g, size_t i) {
+    size_t *heads = g->levels[g->level[i]].heads;
+    size_t cell = cell_of(g, i);
+    g->prev[i] = NO_PARTICLE;
+    g->next[i] = heads[cell];
+    if (heads[cell] != NO_PARTICLE)
+        g->prev[heads[cell]] = i;
+    heads[cell] = i;
+}
+
+static void cell_unlink(hgrid_t *g, size_t i) {
+    if (g->prev[i] != NO_PARTICLE)
+        g->next[g->prev[i]] = g->next[i];
+    else
+        g->levels[g->level[i]].heads[cell_of(g, i)] = g->next[i];
+    if (g->next[i] != NO_PARTICLE)
+        g->prev[g->next[i]] = g->prev[i];
+}
+
+static void push(hgrid_t *g, size_t *count, size_t j) {
+    if (*count == g->buffer_capacity) {
+        g->buffer_capacity = (g->buffer_capacity==0) ? 64 : 2*g->buffer_capacity;
+        g->buffer = realloc(g->buffer, g->buffer_capacity * sizeof *g->buffer);
+    }
+    g->buffer[(*count)++] = j;
+}
+
+// cells of level `l` along `d` where a particle can touch particle i, if i was in cell `c` of its level
+static void cell_range(hgrid_t const *g, size_t i, size_t l, size_t d, long c, long *lo, long *hi) {
+    level_t const *own = &g->levels[g->level[i]];
+    level_t const *level = &g->levels[l];
+    if (level == own) { // both radii are at most half a cell: adjacent cells
+        *lo = c-1;
+        *hi = c+1;
+    } else {
+        loc_t reach = g->radius[i] + level->max_radius;
+        *lo = (long)floorl((c*own->cell_width - reach) / level->cell_width);
+        *hi = (long)ceill(((c+1)*own->cell_width + reach) / level->cell_width) - 1;
+    }
+    if (*lo < 0) *lo = 0;
+    if (*hi >= (long)level->width) *hi = (long)level->width - 1;
+}
+
+// gather the particles close to the cell of i at every level,
+// only keeping the cells which were not close before i moved along `fixed_dim` in direction `dir`
+// (no restriction if `fixed_dim>=NB_DIM`)
+static size_t collect(hgrid_t *g, size_t i, size_t fixed_dim, int dir) {
+    size_t count = 0;
+    for (size_t l = 0; l < g->nb_levels; l++) {
+        level_t const *level = &g->levels[l];
+        if (level->nb_part == 0) continue;
+        long lo[NB_DIM], hi[NB_DIM], c[NB_DIM];
+        bool empty = false;
+        for (size_t d = 0; d < NB_DIM; d++) {
+            long coord = (long)g->coords[i*NB_DIM+d];
+            cell_range(g, i, l, d, coord, &lo[d], &hi[d]);
+            if (d == fixed_dim) { // remove the cells of the previous range
+                long old_lo, old_hi;
+                cell_range(g, i, l, d, coord-dir, &old_lo, &old_hi);
+                if (dir > 0 && old_hi+1 > lo[d]) lo[d] = old_hi+1;
+                if (dir < 0 && old_lo-1 < hi[d]) hi[d] = old_lo-1;
+            }
+            empty = empty || lo[d] > hi[d];
+            c[d] = lo[d];
+        }
+        if (empty) continue;
+        while (true) { // iterate through the cells of the range
+            size_t cell = 0;
+            for (size_t d = NB_DIM; d-- > 0;)
+                cell = cell*level->width + (size_t)c[d];
+            for (size_t j = level->heads[cell]; j != NO_PARTICLE; j = g->next[j])
+                push(g, &count, j);
+            size_t d = 0;
+            while (d < NB_DIM && c[d] == hi[d]) {
+                c[d] = lo[d];
+                d++;
+            }
+            if (d == NB_DIM) break;
+            c[d]++;
+        }
+    }
+    return count;
+}
+
+
+
+hgrid_t *
+hgrid_new(size_t nb_part, loc_t min_width, loc_t max_width)
+{
+    hgrid_t *g = malloc(sizeof *g);
+    *g = (hgrid_t){0, {{0}},
+                   malloc(nb_part * sizeof *g->level),
+                   malloc(nb_part * sizeof *g->radius),
+                   malloc(nb_part * sizeof *g->next),
+                   malloc(nb_part * sizeof *g->prev),
+                   malloc(nb_part * NB_DIM * sizeof *g->coords),
+                   NULL, 0};
+    // finest level, like a uniform grid
+    size_t max_cells = (nb_part > 0) ? 2*nb_part : 1; // do not waste memory on empty cells
+    loc_t width = floorl(powl(max_cells, 1.L/NB_DIM) + 1e-9L);
+    if (min_width > 0 && loc_UNIT / min_width < width)
+        width = floorl(loc_UNIT / min_width);
+    size_t w = (width >= 1) ? (size_t)width : 1;
+    while (true) { // coarser levels, until the biggest particles fit
+        size_t nb_cells = 1;
+        for (size_t d = 0; d < NB_DIM; d++)
+            nb_cells *= w;
+        level_t *level = &g->levels[g->nb_levels++];
+        *level = (level_t){w, loc_UNIT/w, 0, 0, malloc(nb_cells * sizeof *level->heads)};
+        for (size_t c = 0; c < nb_cells; c++)
+            level->heads[c] = NO_PARTICLE;
+        if (w == 1 || level->cell_width >= max_width || g->nb_levels == HGRID_MAX_LEVELS) break;
+        w /= 2;
+    }
+    return g;
+}
+
+void
+hgrid_insert(hgrid_t *g, size_t i, loc_t const position[NB_DIM], loc_t radius)
+{
+    size_t l = 0;
+    while (l+1 < g->nb_levels && g->levels[l].cell_width < 2*radius)
+        l++;
+    level_t *level = &g->levels[l];
+    g->level[i] = l;
+    g->radius[i] = radius;
+    level->nb_part++;
+    if (radius > level->max_radius)
+        level->max_radius = radius;
+    for (size_t d = 0; d < NB_DIM; d++) {
+        loc_t c = floorl(position[d] / level->cell_width);
+        g->coords[i*NB_DIM+d] = (c < 0) ? 0 : (c >= level->width) ? level->width-1 : (size_t)c;
+    }
+    cell_link(g, i);
+}
+
+void
+hgrid_move(hgrid_t *g, size_t i, size_t dim, int dir)
+{
+    size_t c = g->coords[i*NB_DIM+dim];
+    if ((dir < 0 && c == 0) || (dir > 0 && c+1 >= g->levels[g->level[i]].width)) return;
+    cell_unlink(g, i);
+    g->coords[i*NB_DIM+dim] = c + dir;
+    cell_link(g, i);
+}
+
+loc_t
+hgrid_face(hgrid_t const *g, size_t i, size_t dim, int dir)
+{
+    level_t const *level = &g->levels[g->level[i]];
+    size_t c = g->coords[i*NB_DIM+dim];
+    if (dir > 0)
+        return (c+1 >= level->width) ? NEVER : (c+1)*level->cell_width;
+    else
+        return (c == 0) ? NEVER : c*level->cell_width;
+}
+
+size_t const *
+hgrid_neighbors(hgrid_t *g, size_t i, size_t *count)
+{
+    *count = collect(g, i, NB_DIM, 0);
+    return g->buffer;
+}
+
+size_t const *
+hgrid_new_neighbors(hgrid_t *g, size_t i, size_t dim, int dir, size_t *count)
+{
+    *count = collect(g, i, dim, dir);
+    return g->buffer;
+}
+
+void
+hgrid_deallocate(hgrid_t *g)
+{
+    for (size_t l = 0; l < g->nb_levels; l++)
+        free(g->levels[l].heads);
+    free(g->level);
+    free(g->radius);
+    free(g->next);
+    free(g->prev);
+    free(g->coords);
+    free(g->buffer);
+    free(g);
+}
@@ -0,0 +1,29 @@
+#define _POSIX_C_SOURCE 200112L
+#include "mapping.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void *
+mapping_open(char const *path, size_t *size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void *address = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (address == MAP_FAILED) return NULL;
+    *size = st.st_size;
+    return address;
+}
+
+void
+mapping_close(void *address, size_t size)
+{
+    munmap(address, size);
+}
@@ -0,0 +1,213 @@
+#include "neighbors.h"
+#include "grid.h"
+#include "sweep.h"
+#include "hgrid.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct neighbors {
+    /** The implementation used */
+    enum neighbors_type type;
+    /** The particles */
+    particles_t const  *particles;
+    /** The number of particles which can be registered */
+    size_t              capacity;
+    /** The radius of the biggest particle the structures were built for */
+    loc_t               max_radius;
+    /** The indexes of every particle ({@link NEIGHBORS_ALL}) */
+    size_t             *all;
+    /** The grid ({@link NEIGHBORS_GRID}) */
+    grid_t             *grid;
+    /** The sweep and prune ({@link NEIGHBORS_SWEEP}) */
+    sweep_t            *sweep;
+    /** The hierarchical grid ({@link NEIGHBORS_HGRID}) */
+    hgrid_t            *hgrid;
+};
+
+/** @brief Margin of the boxes of a {@link NEIGHBORS_SWEEP}, relative to the mean radius. */
+#define SWEEP_MARGIN 4
+
+static char const *const neighbors_names[] = {
+    [NEIGHBORS_ALL]   = "all",
+    [NEIGHBORS_GRID]  = "grid",
+    [NEIGHBORS_SWEEP] = "sweep",
+    [NEIGHBORS_HGRID] = "hgrid",
+};
+
+
+
+// register a particle at a position, if it fits in the structures
+static bool insert(neighbors_t *n, size_t i, loc_t const position[NB_DIM]) {
+    particles_t const *ps = n->particles;
+    switch (n->type) {
+        case NEIGHBORS_ALL:
+            break;
+        case NEIGHBORS_GRID: // cells are too small for bigger particles
+            if (ps->radius[i] > n->max_radius) return false;
+            grid_insert(n->grid, i, position);
+            break;
+        case NEIGHBORS_SWEEP: // boxes without margin would never move
+            if (n->max_radius == 0) return false;
+            sweep_insert(n->sweep, i, position, ps->radius[i]);
+            break;
+        case NEIGHBORS_HGRID: // the coarsest cells are too small for bigger particles
+            if (ps->radius[i] > n->max_radius) return false;
+            hgrid_insert(n->hgrid, i, position, ps->radius[i]);
+            break;
+    }
+    return true;
+}
+
+
+
+bool
+neighbors_type_parse(char const *name, enum neighbors_type *type)
+{
+    for (size_t i = 0; i < sizeof neighbors_names / sizeof *neighbors_names; i++)
+        if (strcmp(name, neighbors_names[i]) == 0) {
+            *type = i;
+            return true;
+        }
+    return false;
+}
+
+char const *
+neighbors_type_name(enum neighbors_type type)
+{
+    return neighbors_names[type];
+}
+
+neighbors_t *
+neighbors_new(enum neighbors_type type, particles_t const *ps, time_t timestamp)
+{
+    size_t nb_part = ps->count, capacity = (ps->capacity > nb_part) ? ps->capacity : nb_part;
+    neighbors_t *n = malloc(sizeof *n);
+    *n = (neighbors_t){type, ps, capacity, 0, NULL, NULL, NULL, NULL};
+    loc_t min_radius = (nb_part > 0) ? ps->radius[0] : 0, sum_radius = 0;
+    for (size_t i = 0; i < nb_part; i++) {
+        if (ps->radius[i] < min_radius)
+            min_radius = ps->radius[i];
+        if (ps->radius[i] > n->max_radius)
+            n->max_radius = ps->radius[i];
+        sum_radius += ps->radius[i];
+    }
+    switch (type) {
+        case NEIGHBORS_ALL:
+            n->all = malloc(capacity * sizeof *n->all);
+            for (size_t i = 0; i < capacity; i++)
+                n->all[i] = i;
+            break;
+        case NEIGHBORS_GRID:
+            n->grid = grid_new(capacity, 2*n->max_radius);
+            break;
+        case NEIGHBORS_SWEEP:
+            n->sweep = sweep_new(capacity, (nb_part > 0) ? SWEEP_MARGIN*sum_radius/nb_part : 0);
+            break;
+        case NEIGHBORS_HGRID:
+            n->hgrid = hgrid_new(capacity, 2*min_radius, 2*n->max_radius);
+            break;
+    }
+    for (size_t i = 0; i < nb_part; i++) {
+        loc_t position[NB_DIM];
+        particles_position_at(ps, i, timestamp, position);
+        insert(n, i, position);
+    }
+    return n;
+}
+
+bool
+neighbors_insert(neighbors_t *n, size_t i)
+{
+    particles_t const *ps = n->particles;
+    if (i >= n->capacity) return false;
+    loc_t position[NB_DIM];
+    for (size_t d = 0; d < NB_DIM; d++)
+        position[d] = ps->position[d][i];
+    return insert(n, i, position);
+}
+
+size_t const *
+neighbors_of(neighbors_t *n, size_t i, size_t *count)
+{
+    switch (n->type) {
+        case NEIGHBORS_ALL:
+            *count = n->particles->count;
+            return n->all;
+        case NEIGHBORS_GRID:
+            return grid_neighbors(n->grid, i, count);
+        case NEIGHBORS_SWEEP:
+            return sweep_neighbors(n->sweep, i, count);
+        case NEIGHBORS_HGRID:
+            return hgrid_neighbors(n->hgrid, i, count);
+    }
+    *count = 0;
+    return NULL;
+}
+
+time_t
+neighbors_time_before_crossing(neighbors_t const *n, size_t i, int time_flow, size_t *dim)
+{
+    if (n->type == NEIGHBORS_ALL) return NEVER;
+    particles_t const *ps = n->particles;
+    time_t t_min = NEVER;
+    for (size_t d = 0; d < NB_DIM; d++) { // iterate through dimentions
+        int dir = (ps->velocity[d][i]*time_flow<0) ? -1 : 1;
+        loc_t face = NEVER;
+        switch (n->type) {
+            case NEIGHBORS_ALL:
+                break;
+            case NEIGHBORS_GRID:
+                face = grid_face(n->grid, i, d, dir);
+                break;
+            case NEIGHBORS_SWEEP:
+                face = sweep_face(n->sweep, i, d, dir);
+                break;
+            case NEIGHBORS_HGRID:
+                face = hgrid_face(n->hgrid, i, d, dir);
+                break;
+        }
+        if (isnan(face)) continue; // wall of the box
+        time_t t = path_time(face - ps->position[d][i], ps->velocity[d][i]) * time_flow;
+        if (!isfinite(t)) continue; // not moving along that dimention
+        if (t < 0) t = 0; // already on the face, because of rounding errors
+        if (IS_BEFORE(t, t_min)) {
+            t_min = t;
+            *dim = d;
+        }
+    }
+    return t_min;
+}
+
+size_t const *
+neighbors_cross(neighbors_t *n, size_t i, size_t dim, int time_flow, size_t *count)
+{
+    int dir = (n->particles->velocity[dim][i]*time_flow<0) ? -1 : 1;
+    switch (n->type) {
+        case NEIGHBORS_ALL:
+            break;
+        case NEIGHBORS_GRID:
+            grid_move(n->grid, i, dim, dir);
+            return grid_new_neighbors(n->grid, i, dim, dir, count);
+        case NEIGHBORS_SWEEP:
+            sweep_move(n->sweep, i, dim, dir);
+            return sweep_new_neighbors(n->sweep, i, dim, dir, count);
+        case NEIGHBORS_HGRID:
+            hgrid_move(n->hgrid, i, dim, dir);
+            return hgrid_new_neighbors(n->hgrid, i, dim, dir, count);
+    }
+    *count = 0;
+    return NULL;
+}
+
+void
+neighbors_deallocate(neighbors_t *n)
+{
+    free(n->all);
+    if (n->grid != NULL)
+        grid_deallocate(n->grid);
+    if (n->sweep != NULL)
+        sweep_deallocate(n->sweep);
+    if (n->hgrid != NULL)
+        hgrid_deallocate(n->hgrid);
+    free(n);
+}
@@ -0,0 +1,226 @@
+#define _POSIX_C_SOURCE 200112L
+#include "parallel.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/** @brief What a thread started by {@link parallel_run} needs. */
+typedef struct {
+    parallel_func_t func;
+    void           *data;
+    size_t          thread;
+} start_t;
+
+static void *start(void *arg) {
+    start_t const *s = arg;
+    (*s->func)(s->data, s->thread);
+    return NULL;
+}
+
+/** @brief Tasks left to a thread of {@link parallel_steal}. */
+typedef struct {
+    pthread_mutex_t lock;
+    size_t          next; // first task left
+    size_t          end; // task after the last one left
+} share_t;
+
+/** @brief What the threads of {@link parallel_steal} share. */
+typedef struct {
+    parallel_task_t  func;
+    void            *data;
+    share_t         *shares;
+    size_t           nb_threads;
+} stealing_t;
+
+static bool take(share_t *share, size_t *task) {
+    pthread_mutex_lock(&share->lock);
+    bool found = share->next < share->end;
+    if (found)
+        *task = share->next++;
+    pthread_mutex_unlock(&share->lock);
+    return found;
+}
+
+// move the last half of the tasks left to another thread to the share of a thread
+static bool steal(stealing_t *st, size_t thread) {
+    for (size_t k = 1; k < st->nb_threads; k++) {
+        share_t *victim = &st->shares[(thread+k) % st->nb_threads];
+        pthread_mutex_lock(&victim->lock);
+        size_t left = victim->end - victim->next;
+        size_t first = victim->end - (left+1)/2, end = victim->end;
+        victim->end = first;
+        pthread_mutex_unlock(&victim->lock);
+        if (left == 0) continue;
+        share_t *own = &st->shares[thread];
+        pthread_mutex_lock(&own->lock);
+        own->next = first;
+        own->end = end;
+        pthread_mutex_unlock(&own->lock);
+        return true;
+    }
+    return false;
+}
+
+static void work(void *data, size_t thread) {
+    stealing_t *st = data;
+    size_t task;
+    do {
+        while (take(&st->shares[thread], &task))
+            (*st->func)(st->data, task);
+    } while (steal(st, thread));
+}
+
+struct parallel_pool {
+    pthread_mutex_t  lock;
+    pthread_cond_t   wake; // a work was given, or the pool is stopping
+    pthread_cond_t   done; // the last thread finished its part
+    pthread_t       *threads;
+    size_t           nb_threads; // including the calling thread
+    parallel_func_t  func;
+    void            *data;
+    size_t           generation; // number of works given
+    size_t           pending; // threads still running their part of the work
+    bool             stopping;
+};
+
+/** @brief What a thread of a pool needs. */
+typedef struct {
+    parallel_pool_t *pool;
+    size_t           thread;
+} member_t;
+
+static void *serve(void *arg) {
+    member_t member = *(member_t *)arg;
+    parallel_pool_t *pool = member.pool;
+    free(arg);
+    size_t generation = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        while (!pool->stopping && pool->generation == generation)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->stopping) break;
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+        (*pool->func)(pool->data, member.thread);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+
+
+size_t
+parallel_nb_cpus(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (size_t)n : 1;
+}
+
+void
+parallel_run(size_t nb_threads, parallel_func_t func, void *data)
+{
+    if (nb_threads <= 1) {
+        (*func)(data, 0);
+        return;
+    }
+    pthread_t *threads = malloc(nb_threads * sizeof *threads);
+    start_t *starts = malloc(nb_threads * sizeof *starts);
+    size_t started = 1;
+    for (size_t t = 1; t < nb_threads; t++) {
+        starts[t] = (start_t){func, data, t};
+        if (pthread_create(&threads[t], NULL, &start, &starts[t]) != 0) {
+            (*func)(data, t); // no more thread available: run it here
+            continue;
+        }
+        threads[started++] = threads[t];
+    }
+    (*func)(data, 0);
+    for (size_t t = 1; t < started; t++)
+        pthread_join(threads[t], NULL);
+    free(threads);
+    free(starts);
+}
+
+void
+parallel_steal(size_t nb_threads, size_t nb_tasks, parallel_task_t func, void *data)
+{
+    if (nb_threads < 1)
+        nb_threads = 1;
+    stealing_t st = {func, data, malloc(nb_threads * sizeof *st.shares), nb_threads};
+    for (size_t t = 0; t < nb_threads; t++) {
+        pthread_mutex_init(&st.shares[t].lock, NULL);
+        st.shares[t].next = nb_tasks * t / nb_threads;
+        st.shares[t].end = nb_tasks * (t+1) / nb_threads;
+    }
+    parallel_run(nb_threads, &work, &st);
+    for (size_t t = 0; t < nb_threads; t++)
+        pthread_mutex_destroy(&st.shares[t].lock);
+    free(st.shares);
+}
+
+parallel_pool_t *
+parallel_pool_new(size_t nb_threads)
+{
+    parallel_pool_t *pool = malloc(sizeof *pool);
+    *pool = (parallel_pool_t){.threads=malloc(nb_threads * sizeof *pool->threads), .nb_threads=1};
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (size_t t = 1; t < nb_threads; t++) {
+        member_t *member = malloc(sizeof *member);
+        *member = (member_t){pool, t};
+        if (pthread_create(&pool->threads[t], NULL, &serve, member) != 0) { // no more thread available
+            free(member);
+            break;
+        }
+        pool->nb_threads++;
+    }
+    return pool;
+}
+
+size_t
+parallel_pool_size(parallel_pool_t const *pool)
+{
+    return pool->nb_threads;
+}
+
+void
+parallel_pool_run(parallel_pool_t *pool, parallel_func_t func, void *data)
+{
+    if (pool->nb_threads > 1) {
+        pthread_mutex_lock(&pool->lock);
+        pool->func = func;
+        pool->data = data;
+        pool->pending = pool->nb_threads-1;
+        pool->generation++;
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    (*func)(data, 0);
+    if (pool->nb_threads > 1) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending > 0)
+            pthread_cond_wait(&pool->done, &pool->lock);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+void
+parallel_pool_deallocate(parallel_pool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t t = 1; t < pool->nb_threads; t++)
+        pthread_join(pool->threads[t], NULL);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool);
+}
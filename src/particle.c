@@ -1,41 +1,363 @@
 #include "particle.h"
+#include "mapping.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Number of candidates processed at once by {@link time_before_contacts}. */
+#define CONTACT_BLOCK 64
+
+/** @brief Capacity of a store when it first grows. */
+#define PARTICLES_MIN_CAPACITY 16
+
+/** @brief Number of arrays of a store. */
+#define NB_ARRAYS (2*NB_DIM + 4)
+
+// the arrays of a store, with the size of their cells
+static void arrays_of(particles_t *ps, void **arrays[NB_ARRAYS], size_t sizes[NB_ARRAYS]) {
+    size_t k = 0;
+    arrays[k] = (void **)&ps->col_counter; sizes[k++] = sizeof *ps->col_counter;
+    arrays[k] = (void **)&ps->timestamp;   sizes[k++] = sizeof *ps->timestamp;
+    for (size_t d = 0; d < NB_DIM; d++) {
+        arrays[k] = (void **)&ps->position[d]; sizes[k++] = sizeof *ps->position[d];
+        arrays[k] = (void **)&ps->velocity[d]; sizes[k++] = sizeof *ps->velocity[d];
+    }
+    arrays[k] = (void **)&ps->mass;   sizes[k++] = sizeof *ps->mass;
+    arrays[k] = (void **)&ps->radius; sizes[k++] = sizeof *ps->radius;
+}
+
+particles_t *
+particles_new(size_t capacity)
+{
+    particles_t *ps = malloc(sizeof *ps);
+    ps->count = 0;
+    ps->capacity = capacity;
+    ps->col_counter = malloc(capacity * sizeof *ps->col_counter);
+    ps->timestamp = malloc(capacity * sizeof *ps->timestamp);
+    for (size_t d = 0; d < NB_DIM; d++) {
+        ps->position[d] = malloc(capacity * sizeof *ps->position[d]);
+        ps->velocity[d] = malloc(capacity * sizeof *ps->velocity[d]);
+    }
+    ps->mass = malloc(capacity * sizeof *ps->mass);
+    ps->radius = malloc(capacity * sizeof *ps->radius);
+    ps->mapping = NULL;
+    ps->mapping_size = 0;
+    return ps;
+}
+
+particles_t *
+particles_clone(particles_t const *ps)
+{
+    particles_t *clone = particles_new(ps->capacity);
+    size_t n = clone->count = ps->count;
+    memcpy(clone->col_counter, ps->col_counter, n * sizeof *ps->col_counter);
+    memcpy(clone->timestamp, ps->timestamp, n * sizeof *ps->timestamp);
+    for (size_t d = 0; d < NB_DIM; d++) {
+        memcpy(clone->position[d], ps->position[d], n * sizeof *ps->position[d]);
+        memcpy(clone->velocity[d], ps->velocity[d], n * sizeof *ps->velocity[d]);
+    }
+    memcpy(clone->mass, ps->mass, n * sizeof *ps->mass);
+    memcpy(clone->radius, ps->radius, n * sizeof *ps->radius);
+    return clone;
+}
+
+size_t
+particles_memory(size_t capacity)
+{
+    return capacity * (sizeof(size_t) + sizeof(time_t) + (2*NB_DIM+1)*sizeof(loc_t) + sizeof(mass_t));
+}
+
+bool
+particles_reserve(particles_t *ps, size_t capacity)
+{
+    if (capacity <= ps->capacity) return true;
+    void **arrays[NB_ARRAYS];
+    size_t sizes[NB_ARRAYS];
+    arrays_of(ps, arrays, sizes);
+    for (size_t k = 0; k < NB_ARRAYS; k++)
+        if (capacity > SIZE_MAX / sizes[k]) return false; // the size of the array would wrap around
+    // every array is allocated before any is released, so that a failure leaves the store as it was
+    void *grown[NB_ARRAYS];
+    for (size_t k = 0; k < NB_ARRAYS; k++) {
+        grown[k] = malloc(capacity * sizes[k]);
+        if (grown[k] == NULL) {
+            while (k-- > 0)
+                free(grown[k]);
+            return false;
+        }
+    }
+    for (size_t k = 0; k < NB_ARRAYS; k++) {
+        memcpy(grown[k], *arrays[k], ps->count * sizes[k]);
+        if (ps->mapping == NULL) // the arrays of a file are released with its mapping
+            free(*arrays[k]);
+        *arrays[k] = grown[k];
+    }
+    if (ps->mapping != NULL) {
+        mapping_close(ps->mapping, ps->mapping_size);
+        ps->mapping = NULL;
+        ps->mapping_size = 0;
+    }
+    ps->capacity = capacity;
+    return true;
+}
 
 void
-update(particle_t *p, time_t timestamp)
+particles_deallocate(particles_t *ps)
 {
-    time_t dt = timestamp - p->timestamp;
-    coords_update(p->position, p->velocity, dt);
-    p->timestamp = timestamp;
+    if (ps->mapping != NULL) { // the arrays are part of the file
+        mapping_close(ps->mapping, ps->mapping_size);
+        free(ps);
+        return;
+    }
+    free(ps->col_counter);
+    free(ps->timestamp);
+    for (size_t d = 0; d < NB_DIM; d++) {
+        free(ps->position[d]);
+        free(ps->velocity[d]);
+    }
+    free(ps->mass);
+    free(ps->radius);
+    free(ps);
 }
 
+size_t
+particles_add(particles_t *ps, particle_t const *p)
+{
+    if (ps->count == ps->capacity) // full: double the capacity
+        particles_reserve(ps, (ps->capacity < PARTICLES_MIN_CAPACITY) ? PARTICLES_MIN_CAPACITY : 2*ps->capacity);
+    particles_set(ps, ps->count, p);
+    return ps->count++;
+}
 
-time_t
-time_before_crossing_hplane(particle_t const *p, size_t dim, loc_t pos)
+particle_t
+particles_get(particles_t const *ps, size_t i)
+{
+    particle_t p;
+    p.col_counter = ps->col_counter[i];
+    p.timestamp = ps->timestamp[i];
+    p.mass = ps->mass[i];
+    p.radius = ps->radius[i];
+    for (size_t d = 0; d < NB_DIM; d++) {
+        p.position[d] = ps->position[d][i];
+        p.velocity[d] = ps->velocity[d][i];
+    }
+    return p;
+}
+
+void
+particles_set(particles_t *ps, size_t i, particle_t const *p)
+{
+    ps->col_counter[i] = p->col_counter;
+    ps->timestamp[i] = p->timestamp;
+    ps->mass[i] = p->mass;
+    ps->radius[i] = p->radius;
+    for (size_t d = 0; d < NB_DIM; d++) {
+        ps->position[d][i] = p->position[d];
+        ps->velocity[d][i] = p->velocity[d];
+    }
+}
+
+// kernels for NB_DIM, unrolled when possible
+// the store is sized by NB_DIM at compile time, so the set is chosen at compile time too
+// block arrays are laid out dimension after dimension, `stride` cells apart
+
+#if NB_DIM == 2
+
+static void
+position_at_2d(particles_t const *ps, size_t i, loc_t k, loc_t position[])
+{
+    position[0] = ps->position[0][i] + ps->velocity[0][i] * k;
+    position[1] = ps->position[1][i] + ps->velocity[1][i] * k;
+}
+
+static void
+update_2d(particles_t *ps, size_t i, loc_t k)
+{
+    ps->position[0][i] += ps->velocity[0][i] * k;
+    ps->position[1][i] += ps->velocity[1][i] * k;
+}
+
+// o seen dt after its timestamp, relative to r
+static void
+relative_2d(particles_t const *ps, size_t r, size_t o, loc_t dt, loc_t dpos[], loc_t dvel[], size_t stride)
+{
+    dpos[0]      = ps->position[0][o] + ps->velocity[0][o] * dt;
+    dpos[stride] = ps->position[1][o] + ps->velocity[1][o] * dt;
+    dpos[0]      -= ps->position[0][r];
+    dpos[stride] -= ps->position[1][r];
+    dvel[0]      = ps->velocity[0][o] - ps->velocity[0][r];
+    dvel[stride] = ps->velocity[1][o] - ps->velocity[1][r];
+}
+
+// sums are done in the same order as loc_scal_prod, so results are identical
+static void
+products_2d(loc_t const dpos[], loc_t const dvel[], size_t n, size_t stride, loc_t pv[], loc_t vv[], loc_t pp[])
+{
+    for (size_t k = 0; k < n; k++) {
+        pv[k] = dpos[k] * dvel[k];
+        vv[k] = dvel[k] * dvel[k];
+        pp[k] = dpos[k] * dpos[k];
+        pv[k] += dpos[stride+k] * dvel[stride+k];
+        vv[k] += dvel[stride+k] * dvel[stride+k];
+        pp[k] += dpos[stride+k] * dpos[stride+k];
+    }
+}
+
+static void
+delta_2d(particles_t const *ps, size_t i, size_t j, loc_t dpos[], loc_t dvel[])
 {
-    loc_t dist = pos - p->position[dim];
-    dist += p->radius * (dist>0 ? -1 : 1);
-    return path_time(dist, p->velocity[dim]);
+    dpos[0] = ps->position[0][j] - ps->position[0][i];
+    dvel[0] = ps->velocity[0][j] - ps->velocity[0][i];
+    dpos[1] = ps->position[1][j] - ps->position[1][i];
+    dvel[1] = ps->velocity[1][j] - ps->velocity[1][i];
 }
 
+static void
+kick_2d(particles_t *ps, size_t i, size_t j, loc_t const dpos[], loc_t k_i, loc_t k_j)
+{
+    ps->velocity[0][i] += dpos[0] * k_i;
+    ps->velocity[1][i] += dpos[1] * k_i;
+    ps->velocity[0][j] += dpos[0] * k_j;
+    ps->velocity[1][j] += dpos[1] * k_j;
+}
+
+#define PARTICLE_KERNEL(name) name##_2d
+
+#elif NB_DIM == 3
+
+static void
+position_at_3d(particles_t const *ps, size_t i, loc_t k, loc_t position[])
+{
+    position[0] = ps->position[0][i] + ps->velocity[0][i] * k;
+    position[1] = ps->position[1][i] + ps->velocity[1][i] * k;
+    position[2] = ps->position[2][i] + ps->velocity[2][i] * k;
+}
+
+static void
+update_3d(particles_t *ps, size_t i, loc_t k)
+{
+    ps->position[0][i] += ps->velocity[0][i] * k;
+    ps->position[1][i] += ps->velocity[1][i] * k;
+    ps->position[2][i] += ps->velocity[2][i] * k;
+}
+
+// o seen dt after its timestamp, relative to r
+static void
+relative_3d(particles_t const *ps, size_t r, size_t o, loc_t dt, loc_t dpos[], loc_t dvel[], size_t stride)
+{
+    dpos[0]        = ps->position[0][o] + ps->velocity[0][o] * dt;
+    dpos[stride]   = ps->position[1][o] + ps->velocity[1][o] * dt;
+    dpos[2*stride] = ps->position[2][o] + ps->velocity[2][o] * dt;
+    dpos[0]        -= ps->position[0][r];
+    dpos[stride]   -= ps->position[1][r];
+    dpos[2*stride] -= ps->position[2][r];
+    dvel[0]        = ps->velocity[0][o] - ps->velocity[0][r];
+    dvel[stride]   = ps->velocity[1][o] - ps->velocity[1][r];
+    dvel[2*stride] = ps->velocity[2][o] - ps->velocity[2][r];
+}
+
+// sums are done in the same order as loc_scal_prod, so results are identical
+static void
+products_3d(loc_t const dpos[], loc_t const dvel[], size_t n, size_t stride, loc_t pv[], loc_t vv[], loc_t pp[])
+{
+    for (size_t k = 0; k < n; k++) {
+        pv[k] = dpos[k] * dvel[k];
+        vv[k] = dvel[k] * dvel[k];
+        pp[k] = dpos[k] * dpos[k];
+        pv[k] += dpos[stride+k] * dvel[stride+k];
+        vv[k] += dvel[stride+k] * dvel[stride+k];
+        pp[k] += dpos[stride+k] * dpos[stride+k];
+        pv[k] += dpos[2*stride+k] * dvel[2*stride+k];
+        vv[k] += dvel[2*stride+k] * dvel[2*stride+k];
+        pp[k] += dpos[2*stride+k] * dpos[2*stride+k];
+    }
+}
+
+static void
+delta_3d(particles_t const *ps, size_t i, size_t j, loc_t dpos[], loc_t dvel[])
+{
+    dpos[0] = ps->position[0][j] - ps->position[0][i];
+    dvel[0] = ps->velocity[0][j] - ps->velocity[0][i];
+    dpos[1] = ps->position[1][j] - ps->position[1][i];
+    dvel[1] = ps->velocity[1][j] - ps->velocity[1][i];
+    dpos[2] = ps->position[2][j] - ps->position[2][i];
+    dvel[2] = ps->velocity[2][j] - ps->velocity[2][i];
+}
+
+static void
+kick_3d(particles_t *ps, size_t i, size_t j, loc_t const dpos[], loc_t k_i, loc_t k_j)
+{
+    ps->velocity[0][i] += dpos[0] * k_i;
+    ps->velocity[1][i] += dpos[1] * k_i;
+    ps->velocity[2][i] += dpos[2] * k_i;
+    ps->velocity[0][j] += dpos[0] * k_j;
+    ps->velocity[1][j] += dpos[1] * k_j;
+    ps->velocity[2][j] += dpos[2] * k_j;
+}
+
+#define PARTICLE_KERNEL(name) name##_3d
+
+#endif
+
+void
+particles_position_at(particles_t const *ps, size_t i, time_t timestamp, loc_t position[NB_DIM])
+{
+    loc_t k = (loc_t)(timestamp - ps->timestamp[i])/time_UNIT; // uniform motion
+#ifdef PARTICLE_KERNEL
+    PARTICLE_KERNEL(position_at)(ps, i, k, position);
+#else
+    for (size_t d = 0; d < NB_DIM; d++)
+        position[d] = ps->position[d][i] + ps->velocity[d][i] * k;
+#endif
+}
+
+
 void
-collide_hplane(particle_t *p, size_t dim)
+update(particles_t *ps, size_t i, time_t timestamp)
 {
-    p->velocity[dim] *= -1;
-    p->col_counter++;
+    loc_t k = (loc_t)(timestamp - ps->timestamp[i])/time_UNIT; // uniform motion
+#ifdef PARTICLE_KERNEL
+    PARTICLE_KERNEL(update)(ps, i, k);
+#else
+    for (size_t d = 0; d < NB_DIM; d++)
+        ps->position[d][i] += ps->velocity[d][i] * k;
+#endif
+    ps->timestamp[i] = timestamp;
 }
 
 
 time_t
-time_before_contact(particle_t const *p1, particle_t const *p2)
+time_before_crossing_hplane(particles_t const *ps, size_t i, size_t dim, loc_t pos)
+{
+    loc_t dist = pos - ps->position[dim][i];
+    dist += ps->radius[i] * (dist>0 ? -1 : 1);
+    return path_time(dist, ps->velocity[dim][i]);
+}
+
+void
+collide_hplane(particles_t *ps, size_t i, size_t dim)
 {
-    particle_t p2_temp = *p2; // clone particle
-    update(&p2_temp, p1->timestamp); // see clone at p1 timestamp
+    ps->velocity[dim][i] *= -1;
+    ps->col_counter[i]++;
+}
+
 
+time_t
+time_before_contact(particles_t const *ps, size_t i, size_t j)
+{
     loc_t dvel[NB_DIM];
     loc_t dpos[NB_DIM];
-    loc_delta(p2_temp.position, p1->position, dpos);
-    loc_delta(p2_temp.velocity, p1->velocity, dvel);
-    loc_t dist_min = p1->radius + p2->radius;
+#ifdef PARTICLE_KERNEL
+    loc_t dt = (loc_t)(ps->timestamp[i] - ps->timestamp[j])/time_UNIT;
+    PARTICLE_KERNEL(relative)(ps, i, j, dt, dpos, dvel, 1); // see j at i timestamp
+#else
+    particles_position_at(ps, j, ps->timestamp[i], dpos); // see j at i timestamp
+    for (size_t d = 0; d < NB_DIM; d++) {
+        dpos[d] -= ps->position[d][i];
+        dvel[d] = ps->velocity[d][j] - ps->velocity[d][i];
+    }
+#endif
+    loc_t dist_min = ps->radius[i] + ps->radius[j];
 
     loc_t prod_pv = loc_scal_prod(dpos, dvel);
     loc_t prod_vv = loc_scal_prod(dvel, dvel); // actual relative speed (squared)
@@ -46,19 +368,99 @@ time_before_contact(particle_t const *p1, particle_t const *p2)
     return - (prod_pv+sqrt(deterinant)*(prod_pv/prod_vv>0?-1:1)) / prod_vv * time_UNIT;
 }
 
+size_t
+time_before_contacts(particles_t const *ps, size_t i, size_t const candidates[], size_t count, int time_flow, size_t hits[], time_t times[])
+{
+    size_t nb_hits = 0;
+    for (size_t start = 0; start < count; start += CONTACT_BLOCK) {
+        size_t n = (count-start < CONTACT_BLOCK) ? count-start : CONTACT_BLOCK;
+        size_t ref[CONTACT_BLOCK];
+        loc_t dpos[NB_DIM*CONTACT_BLOCK];
+        loc_t dvel[NB_DIM*CONTACT_BLOCK];
+        loc_t prod_pv[CONTACT_BLOCK];
+        loc_t prod_vv[CONTACT_BLOCK];
+        loc_t prod_pp[CONTACT_BLOCK];
+        size_t approaching[CONTACT_BLOCK];
+        // gather the other particle seen at the reference timestamp, as time_before_contact does
+        for (size_t k = 0; k < n; k++) {
+            size_t j = candidates[start+k];
+            size_t r = ref[k] = (IS_BEFORE(ps->timestamp[i]*time_flow, ps->timestamp[j]*time_flow)) ? j : i;
+            size_t o = (r==i) ? j : i;
+            loc_t dt = (loc_t)(ps->timestamp[r] - ps->timestamp[o])/time_UNIT;
+#ifdef PARTICLE_KERNEL
+            PARTICLE_KERNEL(relative)(ps, r, o, dt, &dpos[k], &dvel[k], CONTACT_BLOCK);
+#else
+            for (size_t d = 0; d < NB_DIM; d++) {
+                dpos[d*CONTACT_BLOCK+k] = ps->position[d][o] + ps->velocity[d][o] * dt;
+                dpos[d*CONTACT_BLOCK+k] -= ps->position[d][r];
+                dvel[d*CONTACT_BLOCK+k] = ps->velocity[d][o] - ps->velocity[d][r];
+            }
+#endif
+        }
+        // scalar products, summed in the same order as loc_scal_prod
+#ifdef PARTICLE_KERNEL
+        PARTICLE_KERNEL(products)(dpos, dvel, n, CONTACT_BLOCK, prod_pv, prod_vv, prod_pp);
+#else
+        for (size_t k = 0; k < n; k++)
+            prod_pv[k] = prod_vv[k] = prod_pp[k] = 0;
+        for (size_t d = 0; d < NB_DIM; d++)
+            for (size_t k = 0; k < n; k++) {
+                prod_pv[k] += dpos[d*CONTACT_BLOCK+k] * dvel[d*CONTACT_BLOCK+k];
+                prod_vv[k] += dvel[d*CONTACT_BLOCK+k] * dvel[d*CONTACT_BLOCK+k];
+                prod_pp[k] += dpos[d*CONTACT_BLOCK+k] * dpos[d*CONTACT_BLOCK+k];
+            }
+#endif
+        // reject the pairs moving apart
+        size_t nb_approaching = 0;
+        for (size_t k = 0; k < n; k++) {
+            approaching[nb_approaching] = k;
+            nb_approaching += (prod_pv[k]*time_flow < 0);
+        }
+        // solve for the remaining pairs
+        for (size_t a = 0; a < nb_approaching; a++) {
+            size_t k = approaching[a];
+            size_t j = candidates[start+k];
+            loc_t dist_min = ps->radius[ref[k]] + ps->radius[(ref[k]==i) ? j : i];
+            loc_t prod_pp_min = dist_min * dist_min;
+            loc_t deterinant = prod_pv[k]*prod_pv[k] - prod_vv[k]*(prod_pp[k]-prod_pp_min);
+            if (deterinant<0) continue;
+            time_t t = - (prod_pv[k]+sqrt(deterinant)*(prod_pv[k]/prod_vv[k]>0?-1:1)) / prod_vv[k] * time_UNIT;
+            t *= time_flow;
+            if (!IS_FUTURE_TIME(t)) continue;
+            hits[nb_hits] = j;
+            times[nb_hits++] = t + ps->timestamp[ref[k]]*time_flow; // absolute time
+        }
+    }
+    return nb_hits;
+}
+
 void
-collide_particle(particle_t *p1, particle_t *p2)
+collide_particle(particles_t *ps, size_t i, size_t j)
 {
     loc_t dvel[NB_DIM];
     loc_t dpos[NB_DIM];
-    loc_delta(p2->position, p1->position, dpos);
-    loc_delta(p2->velocity, p1->velocity, dvel);
+#ifdef PARTICLE_KERNEL
+    PARTICLE_KERNEL(delta)(ps, i, j, dpos, dvel);
+#else
+    for (size_t d = 0; d < NB_DIM; d++) {
+        dpos[d] = ps->position[d][j] - ps->position[d][i];
+        dvel[d] = ps->velocity[d][j] - ps->velocity[d][i];
+    }
+#endif
 
-    double long coeff = 2.0l * loc_scal_prod(dpos, dvel) / (p1->mass+p2->mass) / loc_scal_prod(dpos, dpos);
+    loc_t coeff = 2 * loc_scal_prod(dpos, dvel) / (ps->mass[i]+ps->mass[j]) / loc_scal_prod(dpos, dpos);
     // dp.dp should be equal to (r1+r2)^2, and simulation is more stable if not
 
-    loc_append(p1->velocity, dpos,  p2->mass*coeff);
-    loc_append(p2->velocity, dpos, -p1->mass*coeff);
-    p1->col_counter++;
-    p2->col_counter++;
+    loc_t k_i =  ps->mass[j]*coeff;
+    loc_t k_j = -ps->mass[i]*coeff;
+#ifdef PARTICLE_KERNEL
+    PARTICLE_KERNEL(kick)(ps, i, j, dpos, k_i, k_j);
+#else
+    for (size_t d = 0; d < NB_DIM; d++) {
+        ps->velocity[d][i] += dpos[d] * k_i;
+        ps->velocity[d][j] += dpos[d] * k_j;
+    }
+#endif
+    ps->col_counter[i]++;
+    ps->col_counter[j]++;
 }
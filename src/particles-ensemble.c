@@ -0,0 +1,207 @@
+#include "simulation.h"
+#include "snapshot.h"
+#include "parallel.h"
+#include "chrono.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LINE_SIZE 4096 // longest line of a manifest
+
+static void usage(char const *name) {
+    fprintf(stderr, "Usage :\n");
+    fprintf(stderr, "\t%s [-j threads] [-s] manifest-file output-directory\n", name);
+    fprintf(stderr, "\trun every simulation of the manifest, without display, and write in output-directory:\n");
+    fprintf(stderr, "\t\trun-<n>.txt : the final state of the n-th run, which can be run again\n");
+    fprintf(stderr, "\t\trun-<n>.snap: the same, as a binary snapshot, with -s\n");
+    fprintf(stderr, "\t\tstats.csv   : the statistics of every run\n");
+    fprintf(stderr, "\teach line of the manifest is a run (empty lines and lines starting with `#` are ignored):\n");
+    fprintf(stderr, "\t\tsource duration [scheduler [neighbors]]\n");
+    fprintf(stderr, "\tsource : source-file | snapshot-file | number-of-generated-particles[@packing-fraction][:seed]\n");
+}
+
+/** @brief A simulation of the manifest, and what it gave. */
+typedef struct {
+    char                  source[LINE_SIZE];
+    double                duration;
+    simulation_options_t  options;
+    simulation_stats_t    stats;
+    size_t                count; // number of particles
+    double                run_time; // wall-clock time of the simulation, in seconds
+    char const           *error; // if not NULL, why the run failed
+} run_t;
+
+/** @brief What every run needs. */
+typedef struct {
+    run_t      *runs;
+    char const *directory;
+    bool        snapshots; // if true, final states are written as binary snapshots
+} ensemble_t;
+
+// read a run from a line of the manifest, or return `false` if it is not valid
+static bool parse_run(char const *line, run_t *run) {
+    char scheduler[64] = "", neighbors[64] = "", end[2] = "";
+    *run = (run_t){.options=SIMULATION_DEFAULT_OPTIONS};
+    int nb_fields = sscanf(line, "%4095s %lf %63s %63s %1s", run->source, &run->duration, scheduler, neighbors, end);
+    if (nb_fields < 2 || nb_fields > 4) return false;
+    if (nb_fields > 2 && !scheduler_type_parse(scheduler, &run->options.scheduler)) return false;
+    if (nb_fields > 3 && !neighbors_type_parse(neighbors, &run->options.neighbors)) return false;
+    return true;
+}
+
+// load or generate the particles of a run
+static particles_t *load(run_t *run) {
+    char *endptr;
+    size_t count = strtoul(run->source, &endptr, 10);
+    if (endptr != run->source && (*endptr == '\0' || *endptr == '@' || *endptr == ':')) { // generated
+        long double packing_fraction = 0;
+        unsigned long seed = 6502;
+        if (*endptr == '@')
+            packing_fraction = strtold(endptr+1, &endptr);
+        if (*endptr == ':')
+            seed = strtoul(endptr+1, &endptr, 10);
+        if (*endptr != '\0') {
+            run->error = "not a valid source";
+            return NULL;
+        }
+        particles_t *particles = particles_new(0);
+        if (packing_fraction > 0)
+            generate_packed_particles(particles, count, packing_fraction, seed);
+        else
+            generate_particles(particles, count, seed);
+        return particles;
+    }
+    if (snapshot_check(run->source)) { // binary snapshot, mapped in memory
+        particles_t *particles = snapshot_load(run->source, NULL);
+        if (particles == NULL)
+            run->error = "cannot read snapshot";
+        return particles;
+    }
+    FILE *input_file = fopen(run->source, "r");
+    if (input_file == NULL) {
+        run->error = "cannot read file";
+        return NULL;
+    }
+    particles_t *particles = particles_new(0);
+    load_error_t error;
+    if (load_particles(particles, input_file, &error) == 0 && error.reason != NULL) {
+        reader_print_error(run->source, &error, stderr);
+        run->error = "not a valid file";
+        particles_deallocate(particles);
+        particles = NULL;
+    }
+    fclose(input_file);
+    return particles;
+}
+
+// run the n-th simulation of the manifest, and write its final state
+static void run_task(void *data, size_t n) {
+    ensemble_t const *ensemble = data;
+    run_t *run = &ensemble->runs[n];
+    particles_t *particles = load(run);
+    if (particles == NULL) return;
+    run->count = particles->count;
+    run->options.stats = &run->stats;
+    double start = chrono_now();
+    simulation_loop(particles, run->duration*time_UNIT, NULL, 0, &run->options);
+    run->run_time = chrono_now() - start;
+
+    char path[LINE_SIZE+64], header[LINE_SIZE+64];
+    snprintf(path, sizeof path, "%s/run-%lu.%s", ensemble->directory, (unsigned long)n+1, ensemble->snapshots ? "snap" : "txt");
+    snprintf(header, sizeof header, "%s after %g", run->source, run->duration);
+    FILE *output_file = fopen(path, ensemble->snapshots ? "wb" : "w");
+    if (output_file == NULL)
+        run->error = "cannot write final state";
+    else {
+        if (ensemble->snapshots) {
+            if (!export_snapshot(particles, output_file, header))
+                run->error = "cannot write final state";
+        } else
+            export_particles(particles, output_file, header);
+        fclose(output_file);
+    }
+    particles_deallocate(particles);
+}
+
+/* Run the simulations of a manifest, balanced between threads */
+int main(int argc, char const *argv[]) {
+    size_t nb_threads = parallel_nb_cpus();
+    bool snapshots = false;
+    if (argc>2 && strcmp(argv[1], "-j")==0) {
+        char *endptr;
+        nb_threads = strtoul(argv[2], &endptr, 10);
+        if (endptr==argv[2] || *endptr!='\0' || nb_threads==0) {
+            fprintf(stderr, "not a valid number of threads: %s\n", argv[2]);
+            exit(EXIT_FAILURE);
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc>1 && strcmp(argv[1], "-s")==0) {
+        snapshots = true;
+        argc--;
+        argv++;
+    }
+    if (argc != 3) {
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    FILE *manifest = fopen(argv[1], "r");
+    if (manifest == NULL) {
+        fprintf(stderr, "Cannot read file %s!\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    ensemble_t ensemble = {NULL, argv[2], snapshots};
+    size_t nb_runs = 0, capacity = 0, line_number = 0;
+    char line[LINE_SIZE];
+    while (fgets(line, sizeof line, manifest) != NULL) {
+        line_number++;
+        size_t start = strspn(line, " \t\r\n");
+        if (line[start] == '\0' || line[start] == '#') continue;
+        if (nb_runs == capacity) {
+            capacity = (capacity==0) ? 64 : 2*capacity;
+            ensemble.runs = realloc(ensemble.runs, capacity * sizeof *ensemble.runs);
+        }
+        if (!parse_run(line, &ensemble.runs[nb_runs])) {
+            fprintf(stderr, "%s:%lu: not a valid run: %s", argv[1], (unsigned long)line_number, line);
+            exit(EXIT_FAILURE);
+        }
+        nb_runs++;
+    }
+    fclose(manifest);
+
+    char path[LINE_SIZE];
+    snprintf(path, sizeof path, "%s/stats.csv", argv[2]);
+    FILE *stats_file = fopen(path, "w");
+    if (stats_file == NULL) {
+        fprintf(stderr, "Cannot write file %s!\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    double start = chrono_now();
+    parallel_steal(nb_threads, nb_runs, &run_task, &ensemble);
+    double elapsed = chrono_now() - start;
+
+    fprintf(stats_file, "run,source,duration,scheduler,neighbors,particles,events,invalid,crossings,max-pending,startup(s),run(s),events/s,error\n");
+    size_t nb_events = 0, nb_failed = 0;
+    for (size_t n = 0; n < nb_runs; n++) {
+        run_t const *run = &ensemble.runs[n];
+        if (run->error != NULL) {
+            fprintf(stderr, "run %lu (%s): %s\n", (unsigned long)n+1, run->source, run->error);
+            nb_failed++;
+        }
+        nb_events += run->stats.nb_events;
+        fprintf(stats_file, "%lu,%s,%g,%s,%s,%lu,%lu,%lu,%lu,%lu,%.3f,%.3f,%.0f,%s\n", (unsigned long)n+1, run->source, run->duration,
+                scheduler_type_name(run->options.scheduler), neighbors_type_name(run->options.neighbors), run->count,
+                run->stats.nb_events, run->stats.nb_invalid, run->stats.nb_crossings, run->stats.max_pending,
+                run->stats.startup_time, run->run_time, (run->run_time > 0) ? run->stats.nb_events/run->run_time : 0,
+                (run->error != NULL) ? run->error : "");
+    }
+    fclose(stats_file);
+    printf("%lu runs (%lu failed) on %lu threads: %lu events in %.3fs\n", (unsigned long)nb_runs, (unsigned long)nb_failed,
+           (unsigned long)nb_threads, (unsigned long)nb_events, elapsed);
+
+    free(ensemble.runs);
+    return (nb_failed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -8,42 +8,135 @@ path_time(loc_t dist, loc_t speed)
 }
 
 
+// kernels for NB_DIM, unrolled when possible
+
+#if NB_DIM == 2
+
+static void
+loc_append_2d(loc_t loc[], loc_t const loc2[], loc_t k)
+{
+    loc[0] += loc2[0] * k;
+    loc[1] += loc2[1] * k;
+}
+
+static void
+loc_delta_2d(loc_t const loc1[], loc_t const loc2[], loc_t ans[])
+{
+    ans[0] = loc1[0] - loc2[0];
+    ans[1] = loc1[1] - loc2[1];
+}
+
+// sums are done in the same order as the generic loops, so results are identical
+static loc_t
+loc_scal_prod_2d(loc_t const loc1[], loc_t const loc2[])
+{
+    loc_t ans = loc1[0] * loc2[0];
+    ans += loc1[1] * loc2[1];
+    return ans;
+}
+
+static loc_t
+loc_distance_2d(loc_t const loc1[], loc_t const loc2[])
+{
+    loc_t diff[2];
+    loc_delta_2d(loc1, loc2, diff);
+    return sqrt(loc_scal_prod_2d(diff, diff));
+}
+
+#define LOC_KERNEL(name) name##_2d
+
+#elif NB_DIM == 3
+
+static void
+loc_append_3d(loc_t loc[], loc_t const loc2[], loc_t k)
+{
+    loc[0] += loc2[0] * k;
+    loc[1] += loc2[1] * k;
+    loc[2] += loc2[2] * k;
+}
+
+static void
+loc_delta_3d(loc_t const loc1[], loc_t const loc2[], loc_t ans[])
+{
+    ans[0] = loc1[0] - loc2[0];
+    ans[1] = loc1[1] - loc2[1];
+    ans[2] = loc1[2] - loc2[2];
+}
+
+// sums are done in the same order as the generic loops, so results are identical
+static loc_t
+loc_scal_prod_3d(loc_t const loc1[], loc_t const loc2[])
+{
+    loc_t ans = loc1[0] * loc2[0];
+    ans += loc1[1] * loc2[1];
+    ans += loc1[2] * loc2[2];
+    return ans;
+}
+
+static loc_t
+loc_distance_3d(loc_t const loc1[], loc_t const loc2[])
+{
+    loc_t diff[3];
+    loc_delta_3d(loc1, loc2, diff);
+    return sqrt(loc_scal_prod_3d(diff, diff));
+}
+
+#define LOC_KERNEL(name) name##_3d
+
+#endif
+
 void
-loc_append(loc_t loc[NB_DIM], loc_t const loc2[NB_DIM], long double k)
+loc_append(loc_t loc[NB_DIM], loc_t const loc2[NB_DIM], loc_t k)
 {
+#ifdef LOC_KERNEL
+    LOC_KERNEL(loc_append)(loc, loc2, k);
+#else
     for (size_t d = 0; d < NB_DIM; d++)
         loc[d] += loc2[d] * k;
+#endif
 }
 
 void
 loc_delta(loc_t const loc1[NB_DIM], loc_t const loc2[NB_DIM], loc_t ans[NB_DIM])
 {
+#ifdef LOC_KERNEL
+    LOC_KERNEL(loc_delta)(loc1, loc2, ans);
+#else
     for (size_t d = 0; d < NB_DIM; d++)
         ans[d] = loc1[d] - loc2[d];
+#endif
 }
 
 loc_t
 loc_scal_prod(loc_t const loc1[NB_DIM], loc_t const loc2[NB_DIM])
 {
+#ifdef LOC_KERNEL
+    return LOC_KERNEL(loc_scal_prod)(loc1, loc2);
+#else
     loc_t ans = 0;
     for (size_t d = 0; d < NB_DIM; d++)
         ans += loc1[d] * loc2[d];
     return ans;
+#endif
 }
 
 loc_t
 loc_distance(loc_t const loc1[NB_DIM], loc_t const loc2[NB_DIM])
 {
+#ifdef LOC_KERNEL
+    return LOC_KERNEL(loc_distance)(loc1, loc2);
+#else
     loc_t sq_dist = 0;
     for (size_t d = 0; d < NB_DIM; d++) {
         loc_t diff = loc1[d] - loc2[d];
         sq_dist += diff * diff;
     }
     return sqrt(sq_dist);
+#endif
 }
 
 void
 coords_update(loc_t pos[NB_DIM], loc_t vel[NB_DIM], time_t dt)
 {
-    loc_append(pos, vel, (long double)dt/time_UNIT); // uniform motion
+    loc_append(pos, vel, (loc_t)dt/time_UNIT); // uniform motion
 }
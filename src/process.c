@@ -0,0 +1,75 @@
+#define _POSIX_C_SOURCE 200809L
+#include "process.h"
+#include <errno.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+
+size_t
+process_spawn(size_t nb_workers, process_func_t func, void *data, int channels[], long pids[])
+{
+    fflush(NULL); // buffered output would be written by every worker
+    for (size_t w = 0; w < nb_workers; w++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) return w;
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(pair[0]);
+            close(pair[1]);
+            return w;
+        }
+        if (pid == 0) { // worker
+            for (size_t k = 0; k < w; k++) // channels of the previous workers
+                close(channels[k]);
+            close(pair[0]);
+            (*func)(data, w, pair[1]);
+            close(pair[1]);
+            _exit(0); // without the handlers and buffers of the parent
+        }
+        close(pair[1]);
+        channels[w] = pair[0];
+        pids[w] = pid;
+    }
+    return nb_workers;
+}
+
+bool
+process_send(int channel, void const *buffer, size_t size)
+{
+    char const *bytes = buffer;
+    while (size > 0) {
+        ssize_t n = send(channel, bytes, size, MSG_NOSIGNAL); // a closed channel is reported, not signaled
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool
+process_receive(int channel, void *buffer, size_t size)
+{
+    char *bytes = buffer;
+    while (size > 0) {
+        ssize_t n = read(channel, bytes, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+void
+process_join(size_t nb_workers, int const channels[], long const pids[])
+{
+    for (size_t w = 0; w < nb_workers; w++)
+        close(channels[w]);
+    for (size_t w = 0; w < nb_workers; w++) // only the workers, not other children of the program
+        while (waitpid((pid_t)pids[w], NULL, 0) < 0 && errno == EINTR);
+}
@@ -0,0 +1,186 @@
+#include "radix.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Number of buckets: one for the keys equal to the last extracted key, one per bit. */
+#define RADIX_NB_BUCKETS (8*sizeof(heap_key_t)+1)
+
+/** @brief Minimal number of cells allocated for the values of a non-empty bucket. */
+#define RADIX_MIN_CAPACITY 16
+
+/** @brief A bucket of values, in no particular order. */
+typedef struct {
+    /** The values of the bucket. May be `NULL` */
+    void       **values;
+    /** The keys of the values, stored in the same cells as the values */
+    heap_key_t  *keys;
+    /** The number of values in the bucket */
+    size_t       size;
+    /** The number of cells allocated */
+    size_t       capacity;
+} bucket_t;
+
+struct radix {
+    /** Bucket `b` holds the keys whose highest bit differing from `last` is bit `b-1`,
+     *  bucket `0` holds the keys equal to `last` */
+    bucket_t       buckets[RADIX_NB_BUCKETS];
+    /** The last extracted key, lower or equal to every key in the heap */
+    heap_key_t     last;
+    /** The size of the radix heap */
+    size_t         size;
+    /** The offset of the key inside the values */
+    size_t         key_offset;
+    /** The comparator breaking ties between equal keys, may be `NULL` */
+    compare_func_t tie;
+    /** The operator function used at deallocation */
+    operate_func_t deallocate_value;
+};
+
+
+
+// bucket of a key, relatively to the last extracted key
+static size_t bucket_of(heap_key_t last, heap_key_t key) {
+    heap_key_t diff = key ^ last;
+    return (diff == 0) ? 0 : 8*sizeof(heap_key_t) - __builtin_clzll(diff);
+}
+
+static void bucket_push(bucket_t *bucket, void *value, heap_key_t key) {
+    if (bucket->size == bucket->capacity) {
+        bucket->capacity = (bucket->capacity == 0) ? RADIX_MIN_CAPACITY : 2*bucket->capacity;
+        bucket->values = realloc(bucket->values, bucket->capacity * sizeof *bucket->values);
+        bucket->keys = realloc(bucket->keys, bucket->capacity * sizeof *bucket->keys);
+    }
+    bucket->values[bucket->size] = value;
+    bucket->keys[bucket->size++] = key;
+}
+
+
+
+radix_t *
+radix_new_keyed(size_t key_offset, compare_func_t tie, operate_func_t deallocate_value)
+{
+    radix_t *p_radix = calloc(1, sizeof *p_radix);
+    p_radix->key_offset = key_offset;
+    p_radix->tie = tie;
+    p_radix->deallocate_value = deallocate_value;
+    return p_radix;
+}
+
+size_t
+radix_size(radix_t const *p_radix)
+{
+    return p_radix->size;
+}
+
+void
+radix_insert(radix_t *p_radix, void *value)
+{
+    if (value == NULL) return;
+    heap_key_t key;
+    memcpy(&key, (char const *)value + p_radix->key_offset, sizeof key);
+    if (key < p_radix->last)
+        key = p_radix->last; // too late: extracted next
+    bucket_push(&p_radix->buckets[bucket_of(p_radix->last, key)], value, key);
+    p_radix->size++;
+}
+
+void *
+radix_extract_min(radix_t *p_radix)
+{
+    if (p_radix->size == 0) {
+        p_radix->last = 0; // no more constraint on the next keys
+        return NULL;
+    }
+    bucket_t *buckets = p_radix->buckets;
+    if (buckets[0].size == 0) {
+        size_t b = 1;
+        while (buckets[b].size == 0)
+            b++;
+        bucket_t *bucket = &buckets[b];
+        heap_key_t min = bucket->keys[0];
+        for (size_t i = 1; i < bucket->size; i++)
+            if (bucket->keys[i] < min)
+                min = bucket->keys[i];
+        // every key of the bucket shares its bits above bit b-1 with `min`, so they all move to lower buckets
+        p_radix->last = min;
+        for (size_t i = 0; i < bucket->size; i++)
+            bucket_push(&buckets[bucket_of(min, bucket->keys[i])], bucket->values[i], bucket->keys[i]);
+        bucket->size = 0;
+    }
+    p_radix->size--;
+    bucket_t *first = &buckets[0];
+    if (p_radix->tie != NULL && first->size > 1) { // keys are equal, move the first value by the tie comparator to the end
+        size_t min = first->size-1;
+        for (size_t i = 0; i+1 < first->size; i++)
+            if ((*p_radix->tie)(first->values[i], first->values[min]) < 0)
+                min = i;
+        void *value = first->values[min];
+        first->values[min] = first->values[first->size-1];
+        first->values[first->size-1] = value;
+    }
+    return first->values[--first->size];
+}
+
+size_t
+radix_filter(radix_t *p_radix, filter_func_t keep, void *data)
+{
+    size_t removed = 0;
+    for (size_t b = 0; b < RADIX_NB_BUCKETS; b++) { // keys are unchanged, so values stay in their bucket
+        bucket_t *bucket = &p_radix->buckets[b];
+        size_t size = 0;
+        for (size_t i = 0; i < bucket->size; i++) {
+            if (!(*keep)(bucket->values[i], data)) continue;
+            bucket->values[size] = bucket->values[i];
+            bucket->keys[size++] = bucket->keys[i];
+        }
+        removed += bucket->size - size;
+        bucket->size = size;
+        size_t capacity = bucket->capacity;
+        while (capacity > RADIX_MIN_CAPACITY && size <= capacity/4)
+            capacity /= 2;
+        if (capacity != bucket->capacity) {
+            bucket->capacity = capacity;
+            bucket->values = realloc(bucket->values, capacity * sizeof *bucket->values);
+            bucket->keys = realloc(bucket->keys, capacity * sizeof *bucket->keys);
+        }
+    }
+    p_radix->size -= removed;
+    if (p_radix->size == 0)
+        p_radix->last = 0; // no more constraint on the next keys
+    return removed;
+}
+
+void
+radix_rekey(radix_t *p_radix, heap_key_t last)
+{
+    if (p_radix->size == 0) return;
+    bucket_t old[RADIX_NB_BUCKETS];
+    memcpy(old, p_radix->buckets, sizeof old);
+    memset(p_radix->buckets, 0, sizeof p_radix->buckets);
+    p_radix->last = last;
+    for (size_t b = 0; b < RADIX_NB_BUCKETS; b++) {
+        for (size_t i = 0; i < old[b].size; i++) {
+            heap_key_t key;
+            memcpy(&key, (char const *)old[b].values[i] + p_radix->key_offset, sizeof key);
+            if (key < last)
+                key = last; // too late: extracted next
+            bucket_push(&p_radix->buckets[bucket_of(last, key)], old[b].values[i], key);
+        }
+        free(old[b].values);
+        free(old[b].keys);
+    }
+}
+
+void
+radix_deallocate(radix_t *p_radix)
+{
+    for (size_t b = 0; b < RADIX_NB_BUCKETS; b++) {
+        bucket_t *bucket = &p_radix->buckets[b];
+        if (p_radix->deallocate_value != NULL)
+            for (size_t i = 0; i < bucket->size; i++)
+                (*p_radix->deallocate_value)(bucket->values[i]);
+        free(bucket->values);
+        free(bucket->keys);
+    }
+    free(p_radix);
+}
@@ -0,0 +1,296 @@
+#include "reader.h"
+#include "parallel.h"
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Size of the first chunk read from a file, doubled when it is full. */
+#define READER_CHUNK (1<<20)
+
+/** @brief Minimal number of lines parsed by a thread. */
+#define READER_MIN_LINES 4096
+
+/** @brief Number of values on the line of a particle. */
+#define NB_VALUES (2*NB_DIM+2)
+
+/** @brief Greatest number of significant digits fitting in a 64-bit mantissa. */
+#define MAX_DIGITS 19
+
+/** @brief Powers of ten which are exact doubles. */
+static double const POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/** @brief Powers of ten which are exact long doubles, with a 64-bit mantissa. */
+static long double const POW10L[] = {1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L, 1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L, 1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L};
+
+/** @brief The first error met by a thread. */
+typedef struct {
+    /** The index of the particle whose line is wrong, among the particles read */
+    size_t      index;
+    /** The position of the error in the file */
+    char const *at;
+    /** The description of the error, or `NULL` if there is no error */
+    char const *reason;
+} thread_error_t;
+
+/** @brief The lines parsed by the threads. */
+typedef struct {
+    particles_t    *particles;
+    /** The index in the store of the first particle read */
+    size_t          first;
+    /** The start of the line of each particle */
+    char const    **lines;
+    /** The number of particles read */
+    size_t          count;
+    /** Are values in raw data type? */
+    bool            raw;
+    size_t          nb_threads;
+    /** The first error of each thread */
+    thread_error_t *errors;
+} job_t;
+
+
+
+static bool is_digit(char c) {
+    return '0' <= c && c <= '9';
+}
+
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static char const *skip_blanks(char const *p) {
+    while (is_blank(*p)) p++;
+    return p;
+}
+
+// read a whole file in memory, with a terminating null character
+static char *read_all(FILE *file, size_t *size) {
+    size_t capacity = READER_CHUNK, n = 0, got;
+    char *buffer = malloc(capacity+1);
+    while ((got = fread(buffer+n, 1, capacity-n, file)) > 0) {
+        n += got;
+        if (n == capacity) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity+1);
+        }
+    }
+    buffer[n] = '\0';
+    *size = n;
+    return buffer;
+}
+
+// parse a decimal number as `strtod` would (`strtold` if `extended`),
+// return the end of the number, or `NULL` if there is no number
+static char const *parse_number(char const *s, long double *value, bool extended) {
+    char const *p = s;
+    bool negative = (*p == '-');
+    if (*p == '-' || *p == '+') p++;
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    size_t nb_digits = 0; // significant digits, from the first non-zero one
+    bool any_digit = false;
+    for (; is_digit(*p); p++, any_digit = true) {
+        if (mantissa == 0 && *p == '0') continue;
+        if (++nb_digits <= MAX_DIGITS) mantissa = mantissa*10 + (*p-'0');
+        else exponent++;
+    }
+    if (*p == '.')
+        for (p++; is_digit(*p); p++, any_digit = true) {
+            if (mantissa == 0 && *p == '0') {
+                exponent--;
+                continue;
+            }
+            if (++nb_digits <= MAX_DIGITS) {
+                mantissa = mantissa*10 + (*p-'0');
+                exponent--;
+            }
+        }
+    if (!any_digit || nb_digits > MAX_DIGITS) goto fallback; // special values, or too many digits
+    if (*p == 'e' || *p == 'E') {
+        char const *q = p+1;
+        bool negative_exponent = (*q == '-');
+        if (*q == '-' || *q == '+') q++;
+        if (is_digit(*q)) { // else the exponent is not part of the number
+            int e = 0;
+            for (; is_digit(*q); q++)
+                if (e < 100000) e = e*10 + (*q-'0');
+            exponent += negative_exponent ? -e : e;
+            p = q;
+        }
+    }
+    if (mantissa == 0) {
+        *value = negative ? -0.0L : 0.0L;
+        return p;
+    }
+    // the mantissa and the power of ten are exact: a single rounding, like `strtod`
+    if (!extended && mantissa <= (UINT64_C(1)<<DBL_MANT_DIG) && -22 <= exponent && exponent <= 22) {
+        double v = (double)mantissa;
+        v = (exponent < 0) ? v / POW10[-exponent] : v * POW10[exponent];
+        *value = negative ? -v : v;
+        return p;
+    }
+    if (LDBL_MANT_DIG == 64 && -27 <= exponent && exponent <= 27) {
+        long double v = (long double)mantissa;
+        v = (exponent < 0) ? v / POW10L[-exponent] : v * POW10L[exponent];
+        if (!extended) { // rounding again to a double is only wrong if `v` is halfway between two doubles
+            int e;
+            uint64_t bits = (uint64_t)ldexpl(frexpl(v, &e), 64);
+            if ((bits & 0x7FF) == 0x400) goto fallback;
+            v = (double)v;
+        }
+        *value = negative ? -v : v;
+        return p;
+    }
+    fallback: {
+        char *end;
+        *value = extended ? strtold(s, &end) : strtod(s, &end);
+        return (end == s) ? NULL : end;
+    }
+}
+
+// parse the line of a particle, return the description of the error and its position, or `NULL`
+static char const *parse_line(char const *p, bool raw, particle_t *particle, char const **at) {
+    long double values[NB_VALUES];
+    for (size_t k = 0; k < NB_VALUES; k++) {
+        bool is_loc = (k != NB_VALUES-2); // every value is a location, except the mass
+        bool extended = is_loc && sizeof(loc_t) > sizeof(double);
+        p = skip_blanks(p);
+        char const *end = parse_number(p, &values[k], extended);
+        if (end == NULL) {
+            *at = p;
+            return (*p == '\n' || *p == '\0') ? "missing values" : "number expected";
+        }
+        p = skip_blanks(end);
+        if (*p == ',') p++;
+    }
+    p = skip_blanks(p);
+    if (*p != '\n' && *p != '\0') {
+        *at = p;
+        return "unexpected character after the particle";
+    }
+    loc_t unit = raw ? 1 : loc_UNIT;
+    particle->timestamp   = 0;
+    particle->col_counter = 0;
+    for (size_t d = 0; d < NB_DIM; d++) {
+        particle->position[d] = values[d] * unit;
+        particle->velocity[d] = values[NB_DIM+d] * unit;
+    }
+    particle->mass = values[NB_VALUES-2] * (raw ? 1 : mass_UNIT);
+    particle->radius = values[NB_VALUES-1] * unit;
+    return NULL;
+}
+
+static void parse_lines(void *data, size_t thread) {
+    job_t *job = data;
+    size_t lo = job->count * thread / job->nb_threads;
+    size_t hi = job->count * (thread+1) / job->nb_threads;
+    for (size_t i = lo; i < hi; i++) {
+        particle_t p;
+        char const *at;
+        char const *reason = parse_line(job->lines[i], job->raw, &p, &at);
+        if (reason != NULL) {
+            job->errors[thread] = (thread_error_t){i, at, reason};
+            return;
+        }
+        particles_set(job->particles, job->first+i, &p);
+    }
+}
+
+// fill an error with the line and column of a position in the file
+static void locate(load_error_t *error, char const *buffer, char const *at, char const *reason) {
+    if (error == NULL) return;
+    error->line = 1;
+    char const *line_start = buffer;
+    for (char const *p = buffer; p < at; p++)
+        if (*p == '\n') {
+            error->line++;
+            line_start = p+1;
+        }
+    error->column = at - line_start + 1;
+    error->reason = reason;
+}
+
+
+
+size_t
+reader_load(particles_t *particles, FILE* file, bool raw, load_error_t *error)
+{
+    if (error != NULL) *error = (load_error_t){0, 0, NULL};
+    size_t size;
+    char *buffer = read_all(file, &size);
+    char const *end = buffer + size;
+    char const **lines = NULL;
+    char const *p = memchr(buffer, '\n', size); // skip the description, whatever its length
+    if (p == NULL) {
+        locate(error, buffer, end, "missing number of particles");
+        goto err0;
+    }
+    p = skip_blanks(p+1);
+    if (!is_digit(*p)) {
+        locate(error, buffer, p, "number of particles expected");
+        goto err0;
+    }
+    char *count_end;
+    size_t count = strtoul(p, &count_end, 10);
+    if (count > (size_t)(end - count_end)) { // every particle takes a line, of at least one character
+        locate(error, buffer, end, "missing particles");
+        goto err0;
+    }
+    if (!particles_reserve(particles, particles->count + count)) { // the declared number sizes the store
+        locate(error, buffer, p, "not enough memory for the number of particles");
+        goto err0;
+    }
+    p = skip_blanks(count_end);
+    if (*p != '\n' && *p != '\0') {
+        locate(error, buffer, p, "unexpected character after the number of particles");
+        goto err0;
+    }
+
+    lines = malloc(count * sizeof *lines);
+    size_t nb_lines = 0;
+    while (nb_lines < count && p < end) { // split at line boundaries
+        char const *line = p+1;
+        p = memchr(line, '\n', end-line);
+        if (p == NULL) p = end;
+        if (*skip_blanks(line) != '\n' && skip_blanks(line) < end) // blank lines are ignored
+            lines[nb_lines++] = line;
+    }
+    if (nb_lines < count) {
+        locate(error, buffer, end, "missing particles");
+        goto err0;
+    }
+
+    size_t nb_threads = parallel_nb_cpus();
+    if (nb_threads > count/READER_MIN_LINES) nb_threads = count/READER_MIN_LINES;
+    if (nb_threads == 0) nb_threads = 1;
+    thread_error_t *errors = malloc(nb_threads * sizeof *errors);
+    for (size_t t = 0; t < nb_threads; t++)
+        errors[t] = (thread_error_t){count, NULL, NULL};
+    job_t job = {particles, particles->count, lines, count, raw, nb_threads, errors};
+    parallel_run(nb_threads, &parse_lines, &job);
+    thread_error_t const *first_error = NULL;
+    for (size_t t = 0; t < nb_threads && first_error == NULL; t++) // threads parse consecutive lines
+        if (errors[t].reason != NULL)
+            first_error = &errors[t];
+    if (first_error != NULL) {
+        locate(error, buffer, first_error->at, first_error->reason);
+        free(errors);
+        goto err0;
+    }
+    free(errors);
+    free(lines);
+    free(buffer);
+    particles->count += count;
+    return count;
+    err0: free(lines);
+    free(buffer);
+    return 0;
+}
+
+void
+reader_print_error(char const *path, load_error_t const *error, FILE *stream)
+{
+    fprintf(stream, "%s:%lu:%lu: %s\n", path, error->line, error->column, error->reason);
+}
@@ -0,0 +1,313 @@
+#include "scheduler.h"
+#include "heap.h"
+#include "tournament.h"
+#include "radix.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct scheduler {
+    /** The implementation used */
+    enum scheduler_type type;
+    /** The heap of events ({@link SCHEDULER_HEAP}) */
+    heap_t             *heap;
+    /** The tree of events ({@link SCHEDULER_TOURNAMENT}) */
+    tournament_t       *tree;
+    /** The radix heap of events ({@link SCHEDULER_RADIX}) */
+    radix_t            *radix;
+    /** The number of events held by `tree` */
+    size_t              size;
+    /** The number of events scheduled in each slot since it was last forgotten
+     *  ({@link SCHEDULER_HEAP} and {@link SCHEDULER_RADIX}) */
+    size_t             *live;
+    /** The sum of `live`, an upper bound of the number of valid events */
+    size_t              nb_live;
+    /** The pool from which the events were allocated */
+    event_pool_t       *pool;
+    /** The number of slots */
+    size_t              nb_slots;
+};
+
+static char const *const scheduler_names[] = {
+    [SCHEDULER_HEAP]       = "heap",
+    [SCHEDULER_TOURNAMENT] = "tournament",
+    [SCHEDULER_RADIX]      = "radix",
+};
+
+
+
+bool
+scheduler_type_parse(char const *name, enum scheduler_type *type)
+{
+    for (size_t i = 0; i < sizeof scheduler_names / sizeof *scheduler_names; i++)
+        if (strcmp(name, scheduler_names[i]) == 0) {
+            *type = i;
+            return true;
+        }
+    return false;
+}
+
+char const *
+scheduler_type_name(enum scheduler_type type)
+{
+    return scheduler_names[type];
+}
+
+scheduler_t *
+scheduler_new(enum scheduler_type type, size_t nb_slots, event_pool_t *pool)
+{
+    scheduler_t *s = malloc(sizeof *s);
+    *s = (scheduler_t){type, NULL, NULL, NULL, 0, NULL, 0, pool, nb_slots};
+    switch (type) { // pending events are released along with the pool
+        case SCHEDULER_HEAP:
+            s->heap = heap_new_keyed(offsetof(event_t, key), &compare_events, NULL);
+            s->live = calloc(nb_slots, sizeof *s->live);
+            break;
+        case SCHEDULER_TOURNAMENT:
+            s->tree = tournament_new_keyed(nb_slots, offsetof(event_t, key), &compare_events, NULL);
+            break;
+        case SCHEDULER_RADIX:
+            s->radix = radix_new_keyed(offsetof(event_t, key), &compare_events, NULL);
+            s->live = calloc(nb_slots, sizeof *s->live);
+            break;
+    }
+    return s;
+}
+
+size_t
+scheduler_memory(enum scheduler_type type, size_t nb_slots, size_t nb_events)
+{
+    // an event, its pointer and its key, with cells of the heap or buckets allocated up to twice
+    size_t queued = EVENT_MEMORY + 2*(sizeof(event_t *) + sizeof(heap_key_t));
+    switch (type) {
+        case SCHEDULER_HEAP:
+            return sizeof(scheduler_t) + nb_events * queued;
+        case SCHEDULER_RADIX: // a bucket per key bit and one more, each being two arrays and two sizes
+            return sizeof(scheduler_t) + (8*sizeof(heap_key_t)+1) * (2*sizeof(void *)+2*sizeof(size_t)) + nb_events * queued;
+        case SCHEDULER_TOURNAMENT: // a leaf and a winner per slot, at most one event per slot
+            return sizeof(scheduler_t) + nb_slots * (EVENT_MEMORY + sizeof(event_t *) + sizeof(heap_key_t) + 2*sizeof(size_t));
+    }
+    return 0;
+}
+
+size_t
+scheduler_capacity(enum scheduler_type type, size_t nb_slots, size_t budget)
+{
+    size_t fixed = scheduler_memory(type, nb_slots, 0);
+    if (budget < fixed) return 0;
+    switch (type) {
+        case SCHEDULER_HEAP:
+        case SCHEDULER_RADIX:
+            return (budget - fixed) / (scheduler_memory(type, nb_slots, 1) - fixed);
+        case SCHEDULER_TOURNAMENT:
+            return nb_slots;
+    }
+    return 0;
+}
+
+bool
+scheduler_keeps_earliest_only(scheduler_t const *s)
+{
+    return s->type == SCHEDULER_TOURNAMENT;
+}
+
+void
+scheduler_schedule(scheduler_t *s, size_t slot, event_t *e)
+{
+    if (e == NULL) return;
+    if (s->live != NULL) {
+        s->live[slot]++;
+        s->nb_live++;
+    }
+    switch (s->type) {
+        case SCHEDULER_HEAP:
+            heap_insert(s->heap, e);
+            break;
+        case SCHEDULER_RADIX:
+            radix_insert(s->radix, e);
+            break;
+        case SCHEDULER_TOURNAMENT: {
+            event_t *current = tournament_get(s->tree, slot);
+            if (current != NULL && e->key >= current->key) {
+                event_release(s->pool, e); // not the earliest of its slot
+                break;
+            }
+            if (current == NULL)
+                s->size++;
+            event_release(s->pool, tournament_set(s->tree, slot, e));
+            break;
+        }
+    }
+}
+
+void
+scheduler_schedule_bulk(scheduler_t *s, size_t const slots[], event_t *events[], size_t count)
+{
+    switch (s->type) {
+        case SCHEDULER_HEAP:
+            for (size_t i = 0; i < count; i++)
+                if (events[i] != NULL) {
+                    s->live[slots[i]]++;
+                    s->nb_live++;
+                }
+            heap_insert_bulk(s->heap, (void **)events, count);
+            break;
+        case SCHEDULER_RADIX:
+        case SCHEDULER_TOURNAMENT:
+            for (size_t i = 0; i < count; i++)
+                scheduler_schedule(s, slots[i], events[i]);
+            break;
+    }
+}
+
+void
+scheduler_forget(scheduler_t *s, size_t slot)
+{
+    switch (s->type) {
+        case SCHEDULER_HEAP:
+        case SCHEDULER_RADIX: // stale events will be discarded at extraction, or by a compaction
+            s->nb_live -= (s->live[slot] < s->nb_live) ? s->live[slot] : s->nb_live;
+            s->live[slot] = 0;
+            break;
+        case SCHEDULER_TOURNAMENT:
+            if (tournament_get(s->tree, slot) == NULL) break;
+            s->size--;
+            event_release(s->pool, tournament_set(s->tree, slot, NULL));
+            break;
+    }
+}
+
+event_t *
+scheduler_extract_min(scheduler_t *s)
+{
+    event_t *e = NULL;
+    switch (s->type) {
+        case SCHEDULER_HEAP:
+            e = heap_extract_min(s->heap);
+            break;
+        case SCHEDULER_RADIX:
+            e = radix_extract_min(s->radix);
+            break;
+        case SCHEDULER_TOURNAMENT:
+            if ((e = tournament_extract_min(s->tree, NULL)) != NULL)
+                s->size--;
+            break;
+    }
+    if (s->live != NULL && s->nb_live > scheduler_size(s))
+        s->nb_live = scheduler_size(s);
+    return e;
+}
+
+// filter keeping valid events, releasing the others
+static bool keep_valid(void *event, void *data) {
+    void **context = data; // the pool and the particles
+    if (event_is_valid(event, context[1]))
+        return true;
+    event_release(context[0], event);
+    return false;
+}
+
+size_t
+scheduler_compact(scheduler_t *s, particles_t const *particles)
+{
+    void *context[] = {s->pool, (void *)particles};
+    size_t removed = 0;
+    switch (s->type) {
+        case SCHEDULER_HEAP:
+            removed = heap_filter(s->heap, &keep_valid, context);
+            break;
+        case SCHEDULER_RADIX:
+            removed = radix_filter(s->radix, &keep_valid, context);
+            break;
+        case SCHEDULER_TOURNAMENT:
+            return 0; // stale events are already forgotten
+    }
+    s->nb_live = scheduler_size(s);
+    return removed;
+}
+
+// filter releasing every event
+static bool keep_none(void *event, void *pool) {
+    event_release(pool, event);
+    return false;
+}
+
+void
+scheduler_clear(scheduler_t *s)
+{
+    switch (s->type) {
+        case SCHEDULER_HEAP:
+            heap_filter(s->heap, &keep_none, s->pool);
+            break;
+        case SCHEDULER_RADIX:
+            radix_filter(s->radix, &keep_none, s->pool);
+            break;
+        case SCHEDULER_TOURNAMENT:
+            for (size_t slot = 0; slot < s->nb_slots && s->size > 0; slot++)
+                scheduler_forget(s, slot);
+            return;
+    }
+    memset(s->live, 0, s->nb_slots * sizeof *s->live);
+    s->nb_live = 0;
+}
+
+// filter moving every event earlier, keeping them all
+static bool shift_event(void *event, void *shift) {
+    event_shift(event, *(time_t const *)shift);
+    return true;
+}
+
+void
+scheduler_shift(scheduler_t *s, time_t shift)
+{
+    switch (s->type) {
+        case SCHEDULER_HEAP:
+            heap_filter(s->heap, &shift_event, &shift);
+            break;
+        case SCHEDULER_RADIX: // buckets depend on the keys, relatively to the new origin
+            radix_filter(s->radix, &shift_event, &shift);
+            radix_rekey(s->radix, event_key(0));
+            break;
+        case SCHEDULER_TOURNAMENT:
+            tournament_filter(s->tree, &shift_event, &shift);
+            break;
+    }
+}
+
+size_t
+scheduler_stale(scheduler_t const *s)
+{
+    size_t size = scheduler_size(s);
+    return (s->live == NULL || s->nb_live >= size) ? 0 : size - s->nb_live;
+}
+
+size_t
+scheduler_size(scheduler_t const *s)
+{
+    switch (s->type) {
+        case SCHEDULER_HEAP:
+            return heap_size(s->heap);
+        case SCHEDULER_RADIX:
+            return radix_size(s->radix);
+        case SCHEDULER_TOURNAMENT:
+            return s->size;
+    }
+    return 0;
+}
+
+void
+scheduler_deallocate(scheduler_t *s)
+{
+    switch (s->type) {
+        case SCHEDULER_HEAP:
+            heap_deallocate(s->heap);
+            break;
+        case SCHEDULER_TOURNAMENT:
+            tournament_deallocate(s->tree);
+            break;
+        case SCHEDULER_RADIX:
+            radix_deallocate(s->radix);
+            break;
+    }
+    free(s->live);
+    free(s);
+}
@@ -1,227 +1,709 @@
 #define _POSIX_C_SOURCE 199506L
 #include "simulation.h"
 #include "event.h"
-#include "heap.h"
+#include "scheduler.h"
+#include "neighbors.h"
+#include "domains.h"
+#include "grid.h"
+#include "chrono.h"
+#include "parallel.h"
 #include <stdlib.h>
 
+/** @brief Events waiting to be scheduled all at once. */
+typedef struct {
+    size_t   *slots;
+    event_t **events;
+    size_t    size;
+    size_t    capacity;
+} event_buffer_t;
+
+/** @brief Marker of a particle which has not collided yet, see `simulation.last`. */
+#define LAST_NONE ((size_t)-1)
+
+/** @brief Marker of a particle whose last collision was with a wall, see `simulation.last`. */
+#define LAST_WALL ((size_t)-2)
+
+struct simulation {
+    particles_t          *particles;
+    size_t                capacity; // number of particles the queue and the neighbor search can hold
+    int                   time_flow;
+    time_t                now; // current time, multiplied by time_flow
+    time_t                epoch; // absolute time of the origin of the particle snapshots
+    simulation_options_t  options;
+    simulation_stats_t    stats;
+    event_pool_t         *pool;
+    scheduler_t          *scheduler;
+    neighbors_t          *neighbors;
+    event_buffer_t       *buffer; // if not NULL, events are buffered instead of scheduled
+    size_t               *selected; // candidates kept for a batch, `capacity` cells
+    size_t               *hits; // candidates found by a batch, `capacity` cells
+    time_t               *times; // contact times found by a batch, `capacity` cells
+    size_t               *last; // partner of the last collision of each particle, `LAST_WALL` or `LAST_NONE`
+    parallel_pool_t      *threads; // if not NULL, threads sharing the predictions with many candidates
+    size_t               *slice_hits; // candidates found in the slice of each thread
+};
+
+/** @brief A prediction of the collisions of a particle, shared between the threads of the pool. */
+typedef struct {
+    simulation_t       *sim;
+    size_t              i;
+    size_t const       *candidates;
+    size_t              count;
+} fan_out_t;
+
+/** @brief Schedule an event, or buffer it if the simulation is buffering. */
+static void schedule(simulation_t *sim, size_t slot, event_t *e) {
+    event_buffer_t *buffer = sim->buffer;
+    if (buffer == NULL) {
+        scheduler_schedule(sim->scheduler, slot, e);
+        return;
+    }
+    if (buffer->size == buffer->capacity) {
+        buffer->capacity = (buffer->capacity==0) ? 1024 : 2*buffer->capacity;
+        buffer->slots  = realloc(buffer->slots,  buffer->capacity * sizeof *buffer->slots);
+        buffer->events = realloc(buffer->events, buffer->capacity * sizeof *buffer->events);
+    }
+    buffer->slots[buffer->size] = slot;
+    buffer->events[buffer->size++] = e;
+}
+
 /** @brief Compute future collision of a particule with an hyperplane. */
-static void compute_collisions_hplane(heap_t *event_heap, particle_t *p, int time_flow) {
+static void compute_collisions_hplane(simulation_t *sim, size_t i) {
+    particles_t *ps = sim->particles;
+    int time_flow = sim->time_flow;
     time_t t_min = NEVER;
     size_t d_min = 0;
     for (size_t d = 0; d < NB_DIM; d++) { // iterate through dimentions
-        time_t t = time_before_crossing_hplane(p, d, (p->velocity[d]*time_flow<0)?0:1*loc_UNIT) * time_flow;
+        time_t t = time_before_crossing_hplane(ps, i, d, (ps->velocity[d][i]*time_flow<0)?0:1*loc_UNIT) * time_flow;
         if (IS_FUTURE_TIME(t) && IS_BEFORE(t, t_min)) {
             t_min = t;
             d_min = d;
         }
     }
     if (IS_FUTURE_TIME(t_min))
-        heap_insert(event_heap, event_collide_hplane(p->timestamp*time_flow+t_min, p, d_min));
+        schedule(sim, i, event_collide_hplane(sim->pool, ps->timestamp[i]*time_flow+t_min, ps, i, d_min));
 }
 
-/** @brief Compute future collision between two particules. */
-static void compute_collisions_particules(heap_t *event_heap, particle_t *p1, particle_t *p2, int time_flow) {
-    time_t t = time_before_contact(p1, p2) * time_flow;
-    if (!IS_FUTURE_TIME(t)) return;
-    heap_insert(event_heap, event_collide_particle(p1->timestamp*time_flow+t, p1, p2));
+/** @brief Schedule the collisions of a particle with the candidates it hits.
+ * @param skip  index of the candidate to ignore (use `EVENT_NO_PARTICLE` to ignore none)
+ */
+static void schedule_contacts(simulation_t *sim, size_t i, size_t const hits[], time_t const times[], size_t nb_hits, size_t skip) {
+    for (size_t k = 0; k < nb_hits; k++) {
+        size_t j = hits[k];
+        time_t t = times[k];
+        if (j == skip) continue;
+        if (!IS_FUTURE_TIME(t - sim->now)) continue; // both snapshots are older than the contact
+        schedule(sim, i, event_collide_particle(sim->pool, t, sim->particles, i, j));
+    }
 }
 
+// slice of the candidates of a thread, so that the hits of every slice fit in the same cells
+static size_t slice_start(fan_out_t const *f, size_t thread) {
+    return f->count * thread / parallel_pool_size(f->sim->threads);
+}
 
-void
-simulation_loop(particle_t *particle_list[], size_t nb_part, time_t duration, void (*callback)(time_t timestamp), time_t callback_rate)
-{
-    int time_flow = 1;
-    if (duration<0) {
-        time_flow *= -1;
+static void predict_slice(void *data, size_t thread) {
+    fan_out_t const *f = data;
+    simulation_t *sim = f->sim;
+    size_t first = slice_start(f, thread), last = slice_start(f, thread+1);
+    sim->slice_hits[thread] = time_before_contacts(sim->particles, f->i, &f->candidates[first], last-first,
+                                                   sim->time_flow, &sim->hits[first], &sim->times[first]);
+}
+
+/** @brief Compute future collisions between a particule and many candidates.
+ * @param skip  index of the candidate to ignore (use `EVENT_NO_PARTICLE` to ignore none)
+ */
+static void compute_collisions_particules(simulation_t *sim, size_t i, size_t const candidates[], size_t count, size_t skip) {
+    if (sim->threads == NULL || count < sim->options.parallel_candidates) {
+        size_t nb_hits = time_before_contacts(sim->particles, i, candidates, count, sim->time_flow, sim->hits, sim->times);
+        schedule_contacts(sim, i, sim->hits, sim->times, nb_hits, skip);
+        return;
     }
-    if (callback_rate<0)
-        callback_rate *= -1;
-    heap_t *event_heap = heap_new(&compare_events, &free); // queue of future events
-    if (!EQ_TIME_ZERO(callback_rate)) // create first refresh event
-        heap_insert(event_heap, event_refresh(0));
-    for (size_t i = 0; i < nb_part; i++) { // compute every collision events at initial state
-        compute_collisions_hplane(event_heap, particle_list[i], time_flow);
-        for (size_t j = i+1; j < nb_part; j++) {
-            compute_collisions_particules(event_heap, particle_list[i], particle_list[j], time_flow);
+    fan_out_t f = {sim, i, candidates, count};
+    parallel_pool_run(sim->threads, &predict_slice, &f);
+    // events are allocated from the pool by this thread only, in the order of the candidates
+    event_buffer_t batch = {NULL, NULL, 0, 0};
+    bool buffering = sim->buffer != NULL;
+    if (!buffering)
+        sim->buffer = &batch;
+    for (size_t t = 0; t < parallel_pool_size(sim->threads); t++) {
+        size_t first = slice_start(&f, t);
+        schedule_contacts(sim, i, &sim->hits[first], &sim->times[first], sim->slice_hits[t], skip);
+    }
+    if (buffering) return;
+    scheduler_schedule_bulk(sim->scheduler, batch.slots, batch.events, batch.size);
+    sim->buffer = NULL;
+    free(batch.slots);
+    free(batch.events);
+}
+
+/** @brief Compute future crossing of a particule with a face of its cell. */
+static void compute_crossing(simulation_t *sim, size_t i) {
+    particles_t *ps = sim->particles;
+    size_t dim = 0;
+    time_t t = neighbors_time_before_crossing(sim->neighbors, i, sim->time_flow, &dim);
+    if (IS_FUTURE_TIME(t))
+        schedule(sim, i, event_cross_cell(sim->pool, ps->timestamp[i]*sim->time_flow+t, ps, i, dim));
+}
+
+/** @brief Compute every future event of a particle, except collision with a given one.
+ * @param i  index of the particle
+ * @param skip  index of the particle to ignore (use `EVENT_NO_PARTICLE` to ignore none)
+ */
+static void compute_collisions(simulation_t *sim, size_t i, size_t skip) {
+    compute_collisions_hplane(sim, i);
+    compute_crossing(sim, i);
+    size_t count;
+    size_t const *candidates = neighbors_of(sim->neighbors, i, &count);
+    compute_collisions_particules(sim, i, candidates, count, skip);
+}
+
+
+// candidates of a particle whose collisions are computed with every other ones, each pair once
+static size_t select_candidates(simulation_t *sim, size_t i, size_t const *last, size_t selected[], size_t const **candidates) {
+    if (last != NULL && last[i] != LAST_NONE) { // only its next collision
+        *candidates = &last[i];
+        return (last[i] != LAST_WALL) ? 1 : 0;
+    }
+    size_t count;
+    size_t const *neighbors = neighbors_of(sim->neighbors, i, &count);
+    size_t nb_selected = 0;
+    for (size_t k = 0; k < count; k++) {
+        size_t j = neighbors[k];
+        selected[nb_selected] = j;
+        nb_selected += (j > i || (last != NULL && last[j] != LAST_NONE)); // each pair once
+    }
+    *candidates = selected;
+    return nb_selected;
+}
+
+/** @brief Contacts of a range of particles, found by a thread before their events are allocated. */
+typedef struct {
+    size_t   first; // first particle of the range
+    size_t   end; // particle after the range
+    size_t  *selected; // candidates of the current particle, one cell per particle
+    size_t  *hits;
+    time_t  *times;
+    size_t   size;
+    size_t   capacity;
+    size_t  *row_end; // number of contacts found up to each particle of the range
+} contacts_t;
+
+/** @brief Contacts of every particle, shared between the threads of the pool. */
+typedef struct {
+    simulation_t       *sim;
+    size_t const       *last;
+    contacts_t         *parts;
+} startup_t;
+
+static void predict_rows(void *data, size_t thread) {
+    startup_t const *st = data;
+    simulation_t *sim = st->sim;
+    contacts_t *c = &st->parts[thread];
+    size_t count = sim->particles->count;
+    for (size_t i = c->first; i < c->end; i++) {
+        if (c->size+count > c->capacity) {
+            c->capacity = (c->size+count > 2*c->capacity) ? c->size+count : 2*c->capacity;
+            c->hits = realloc(c->hits, c->capacity * sizeof *c->hits);
+            c->times = realloc(c->times, c->capacity * sizeof *c->times);
+        }
+        size_t const *candidates;
+        size_t nb_candidates = select_candidates(sim, i, st->last, c->selected, &candidates);
+        c->size += time_before_contacts(sim->particles, i, candidates, nb_candidates, sim->time_flow,
+                                        &c->hits[c->size], &c->times[c->size]);
+        c->row_end[i-c->first] = c->size;
+    }
+}
+
+/** @brief Compute the collisions between every particles on the threads of the pool, and buffer their events.
+ *
+ * Particle `i` is tried against the `n-i-1` following ones: ranges are
+ * balanced on this triangular work. Events are allocated afterwards by the
+ * calling thread, in the order of the particles, as by {@link compute_all_collisions}.
+ */
+static void compute_all_contacts(simulation_t *sim, size_t const *last) {
+    size_t n = sim->particles->count, nb_threads = parallel_pool_size(sim->threads);
+    startup_t st = {sim, last, malloc(nb_threads * sizeof *st.parts)};
+    long double total = (long double)n*(n+1)/2, done = 0;
+    size_t i = 0;
+    for (size_t t = 0; t < nb_threads; t++) {
+        contacts_t *c = &st.parts[t];
+        c->first = i;
+        for (; i < n && done < total*(t+1)/nb_threads; i++)
+            done += n-i;
+        if (t+1 == nb_threads)
+            i = n;
+        *c = (contacts_t){c->first, i, malloc(n * sizeof *c->selected), NULL, NULL, 0, 0,
+                          malloc((i - c->first) * sizeof *c->row_end)};
+    }
+    parallel_pool_run(sim->threads, &predict_rows, &st);
+    for (size_t t = 0; t < nb_threads; t++) {
+        contacts_t *c = &st.parts[t];
+        size_t row_start = 0;
+        for (size_t i = c->first; i < c->end; i++) {
+            compute_collisions_hplane(sim, i);
+            compute_crossing(sim, i);
+            size_t row_end = c->row_end[i-c->first];
+            schedule_contacts(sim, i, &c->hits[row_start], &c->times[row_start], row_end-row_start, EVENT_NO_PARTICLE);
+            row_start = row_end;
         }
+        free(c->selected);
+        free(c->hits);
+        free(c->times);
+        free(c->row_end);
+    }
+    free(st.parts);
+}
+
+/** @brief Compute every future event of every particle, and schedule them at once.
+ * @param last  if not `NULL`, the last collision of each particle, which is known to be
+ *              its next collision: the other ones are only searched for particles
+ *              which have not collided yet
+ */
+static void compute_all_collisions(simulation_t *sim, size_t const *last) {
+    event_buffer_t buffer = {NULL, NULL, 0, 0};
+    sim->buffer = &buffer;
+    if (sim->threads != NULL && sim->options.neighbors == NEIGHBORS_ALL // other searches share a buffer of candidates
+        && sim->particles->count >= sim->options.parallel_candidates)
+        compute_all_contacts(sim, last);
+    else
+        for (size_t i = 0; i < sim->particles->count; i++) {
+            compute_collisions_hplane(sim, i);
+            compute_crossing(sim, i);
+            size_t const *candidates;
+            size_t count = select_candidates(sim, i, last, sim->selected, &candidates);
+            compute_collisions_particules(sim, i, candidates, count, EVENT_NO_PARTICLE);
+        }
+    scheduler_schedule_bulk(sim->scheduler, buffer.slots, buffer.events, buffer.size);
+    sim->buffer = NULL;
+    free(buffer.slots);
+    free(buffer.events);
+}
+
+/** @brief Create the queue and the neighbor search for the capacity of the store, and predict every event. */
+static void build(simulation_t *sim) {
+    particles_t *ps = sim->particles;
+    size_t capacity = sim->capacity;
+    sim->capacity = (ps->capacity > ps->count) ? ps->capacity : ps->count;
+    sim->scheduler = scheduler_new(sim->options.scheduler, sim->capacity, sim->pool); // one slot per particle
+    sim->neighbors = neighbors_new(sim->options.neighbors, ps, sim->now*sim->time_flow);
+    sim->selected = realloc(sim->selected, sim->capacity * sizeof *sim->selected);
+    sim->hits = realloc(sim->hits, sim->capacity * sizeof *sim->hits);
+    sim->times = realloc(sim->times, sim->capacity * sizeof *sim->times);
+    sim->last = realloc(sim->last, sim->capacity * sizeof *sim->last);
+    for (size_t i = capacity; i < sim->capacity; i++)
+        sim->last[i] = LAST_NONE;
+    compute_all_collisions(sim, NULL);
+}
+
+/** @brief Move every particle to the current time. */
+static void synchronize(simulation_t *sim) {
+    particles_t *ps = sim->particles;
+    for (size_t i = 0; i < ps->count; i++)
+        update(ps, i, sim->now*sim->time_flow);
+}
+
+/** @brief Create the queue and the neighbor search again, for a store which has grown. */
+static void rebuild(simulation_t *sim) {
+    scheduler_clear(sim->scheduler);
+    scheduler_deallocate(sim->scheduler);
+    neighbors_deallocate(sim->neighbors);
+    build(sim);
+}
+
+/** @brief Move the epoch to the current time.
+ *
+ * Snapshots and pending events are shifted so that the current time becomes
+ * zero, which keeps the order of the events: nothing is predicted again.
+ */
+static void move_epoch(simulation_t *sim) {
+    time_t shift = sim->now / sim->time_flow; // absolute shift
+    particles_t *ps = sim->particles;
+    for (size_t i = 0; i < ps->count; i++)
+        ps->timestamp[i] -= shift;
+    sim->epoch += shift;
+    scheduler_shift(sim->scheduler, sim->now); // events are timed along the flow
+    sim->now = 0;
+}
+
+
+simulation_options_t const SIMULATION_DEFAULT_OPTIONS = {
+    .scheduler            = SCHEDULER_HEAP,
+    .neighbors            = NEIGHBORS_GRID,
+    .compaction_threshold = 0.5,
+#ifdef DOUBLE_PRECISION
+    .epoch_period         = 1024*time_UNIT,
+#else
+    .epoch_period         = 0,
+#endif
+    .nb_threads           = 0,
+    .parallel_candidates  = 2048,
+    .nb_domains           = 0,
+    .domain_processes     = false,
+    .observer             = NULL,
+    .observer_data        = NULL,
+    .stats                = NULL,
+};
+
+simulation_t *
+simulation_new(particles_t *particles, int time_flow, simulation_options_t const *options)
+{
+    time_flow = (time_flow<0) ? -1 : 1;
+    time_t oldest = 0;
+    for (size_t i = 0; i < particles->count; i++) // start from the oldest snapshot
+        if (i == 0 || IS_BEFORE(particles->timestamp[i]*time_flow, oldest*time_flow))
+            oldest = particles->timestamp[i];
+    return simulation_new_at(particles, time_flow, oldest, options);
+}
+
+simulation_t *
+simulation_new_at(particles_t *particles, int time_flow, time_t timestamp, simulation_options_t const *options)
+{
+    if (options == NULL)
+        options = &SIMULATION_DEFAULT_OPTIONS;
+    simulation_t *sim = malloc(sizeof *sim);
+    time_flow = (time_flow<0) ? -1 : 1;
+    *sim = (simulation_t){particles, 0, time_flow, timestamp*time_flow, 0, *options,
+                          {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, {0, 0, 0, 0, 0}},
+                          event_pool_new(), NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+    if (options->nb_threads > 1) {
+        sim->threads = parallel_pool_new(options->nb_threads);
+        sim->slice_hits = malloc(parallel_pool_size(sim->threads) * sizeof *sim->slice_hits);
     }
+    double start = chrono_now();
+    build(sim); // compute every collision events at initial state
+    sim->stats.startup_time = chrono_now() - start;
+    return sim;
+}
 
+time_t
+simulation_time(simulation_t const *sim)
+{
+    return sim->epoch + sim->now*sim->time_flow;
+}
+
+time_t
+simulation_epoch(simulation_t const *sim)
+{
+    return sim->epoch;
+}
+
+void
+simulation_advance_to(simulation_t *sim, time_t timestamp)
+{
+    particles_t *particles = sim->particles;
+    simulation_options_t const *options = &sim->options;
+    simulation_stats_t *stats = &sim->stats;
+    int time_flow = sim->time_flow;
+    bool earliest_only = scheduler_keeps_earliest_only(sim->scheduler);
     event_t *event;
-    while ((event=heap_extract_min(event_heap)) != NULL) { // mail loop: process queued events
-        if (IS_BEFORE(duration*time_flow, event->timestamp)) { // end of simulation reached
-            free(event);
+    while ((event=scheduler_extract_min(sim->scheduler)) != NULL) { // mail loop: process queued events
+        if (scheduler_size(sim->scheduler)+1 > stats->max_pending)
+            stats->max_pending = scheduler_size(sim->scheduler)+1;
+        time_t t_event = event_timestamp(event);
+        if (IS_BEFORE((timestamp-sim->epoch)*time_flow, t_event)) { // target reached: the event stays pending
+            scheduler_schedule(sim->scheduler, event->particle_a, event);
             break;
         }
-        if (get_event_type(event)!=EVENT_REFRESH)
-        if (!event_is_valid(event)) { // discard invalid events
-            free(event);
+        sim->now = t_event;
+        if (!event_is_valid(event, particles)) { // discard invalid events
+            stats->nb_invalid++;
+            if (earliest_only) // the partner has moved on: the slot needs a new prediction
+                compute_collisions(sim, event->particle_a, EVENT_NO_PARTICLE);
+            event_release(sim->pool, event);
             continue;
         }
-        time_t t = event->timestamp / time_flow;
+        time_t t = t_event / time_flow;
+        size_t a = event->particle_a, b = event->particle_b, count;
+        size_t const *candidates;
         switch (get_event_type(event)) {
             case EVENT_COLLIDE_PARTICLE:
                 // update concerned particles
-                update(event->particle_a, t);
-                update(event->particle_b, t);
-                collide_particle(event->particle_a, event->particle_b);
+                update(particles, a, t);
+                update(particles, b, t);
+                collide_particle(particles, a, b);
+                sim->last[a] = b;
+                sim->last[b] = a;
+                if (options->observer != NULL)
+                    (*options->observer)(particles, a, b, options->observer_data);
                 // compute collisions
-                compute_collisions_hplane(event_heap, event->particle_a, time_flow);
-                compute_collisions_hplane(event_heap, event->particle_b, time_flow);
-                for (size_t i = 0; i < nb_part; i++) {
-                    if (particle_list[i] == event->particle_a) continue;
-                    if (particle_list[i] == event->particle_b) continue;
-                    compute_collisions_particules(event_heap, event->particle_a, particle_list[i], time_flow);
-                    compute_collisions_particules(event_heap, event->particle_b, particle_list[i], time_flow);
-                }
+                scheduler_forget(sim->scheduler, a);
+                scheduler_forget(sim->scheduler, b);
+                compute_collisions(sim, a, b);
+                compute_collisions(sim, b, a);
                 break;
             case EVENT_COLLIDE_HPLANE:
                 // update concerned particles
-                update(event->particle_a, t);
-                collide_hplane(event->particle_a, event->particle_b_col);
+                update(particles, a, t);
+                collide_hplane(particles, a, event->particle_b_col);
+                sim->last[a] = LAST_WALL;
+                if (options->observer != NULL)
+                    (*options->observer)(particles, a, EVENT_NO_PARTICLE, options->observer_data);
                 // compute collisions
-                compute_collisions_hplane(event_heap, event->particle_a, time_flow);
-                for (size_t i = 0; i < nb_part; i++) {
-                    if (particle_list[i] == event->particle_a) continue;
-                    compute_collisions_particules(event_heap, event->particle_a, particle_list[i], time_flow);
-                }
+                scheduler_forget(sim->scheduler, a);
+                compute_collisions(sim, a, EVENT_NO_PARTICLE);
                 break;
-            case EVENT_REFRESH:
-                (*callback)(t);
-                heap_insert(event_heap, event_refresh(t*time_flow+callback_rate));
+            case EVENT_CROSS_CELL:
+                // no update: the trajectory is unchanged, and keeping the snapshot avoids rounding errors
+                candidates = neighbors_cross(sim->neighbors, a, event->particle_b_col-NB_DIM, time_flow, &count);
+                stats->nb_crossings++;
+                // compute collisions
+                if (earliest_only) { // the slot was emptied, every event is needed again
+                    compute_collisions(sim, a, EVENT_NO_PARTICLE);
+                    break;
+                }
+                compute_crossing(sim, a); // other predictions are still valid
+                compute_collisions_particules(sim, a, candidates, count, EVENT_NO_PARTICLE);
                 break;
         }
-        free(event);
+        stats->nb_events++;
+        event_release(sim->pool, event);
+        size_t pending = scheduler_size(sim->scheduler);
+        if (options->compaction_threshold > 0 && pending > particles->count
+            && scheduler_stale(sim->scheduler) > options->compaction_threshold*pending) { // too many stale events
+            size_t removed = scheduler_compact(sim->scheduler, particles);
+            stats->nb_compactions++;
+            stats->nb_compacted += removed;
+            stats->compacted_memory += scheduler_memory(options->scheduler, sim->capacity, pending)
+                                     - scheduler_memory(options->scheduler, sim->capacity, pending-removed);
+        }
+        if (options->epoch_period > 0 && sim->now >= options->epoch_period) { // timestamps are growing too big
+            move_epoch(sim);
+            stats->nb_epochs++;
+        }
     }
+    time_t target = (timestamp-sim->epoch)*time_flow;
+    if (IS_BEFORE(sim->now, target))
+        sim->now = target;
+}
+
+size_t
+simulation_add_particle(simulation_t *sim, particle_t const *p)
+{
+    particle_t added = *p;
+    added.timestamp -= sim->epoch;
+    size_t i = particles_add(sim->particles, &added);
+    update(sim->particles, i, sim->now*sim->time_flow); // snapshot at the current time
+    if (i < sim->capacity && neighbors_insert(sim->neighbors, i))
+        compute_collisions(sim, i, EVENT_NO_PARTICLE); // other predictions are still valid
+    else // the store has outgrown the structures, which are created again
+        rebuild(sim);
+    return i;
+}
+
+void
+simulation_reverse_time(simulation_t *sim)
+{
+    synchronize(sim); // predict from the current positions
+    scheduler_clear(sim->scheduler); // predictions of the other direction
+    sim->time_flow *= -1;
+    sim->now *= -1;
+    // retracing its path, the next collision of a particle is its last one
+    compute_all_collisions(sim, sim->last);
+    for (size_t i = 0; i < sim->particles->count; i++) // the path beyond the reversal is yet unknown
+        sim->last[i] = LAST_NONE;
+}
 
-    heap_deallocate(event_heap);
+void
+simulation_destroy(simulation_t *sim)
+{
+    particles_t *particles = sim->particles;
+    time_t now = sim->now*sim->time_flow;
+    scheduler_deallocate(sim->scheduler);
+    neighbors_deallocate(sim->neighbors);
+    free(sim->selected);
+    free(sim->hits);
+    free(sim->times);
+    free(sim->last);
+    if (sim->threads != NULL)
+        parallel_pool_deallocate(sim->threads);
+    free(sim->slice_hits);
+    sim->stats.pool = event_pool_stats(sim->pool);
+    event_pool_deallocate(sim->pool); // release pending events at once
+    if (sim->options.stats != NULL)
+        *sim->options.stats = sim->stats;
 
-    // set particles position at simulation final time.
-    for (size_t i = 0; i < nb_part; i++) {
-        update(particle_list[i], duration);
+    // set particles position at current time, as absolute snapshots.
+    for (size_t i = 0; i < particles->count; i++) {
+        update(particles, i, now);
+        particles->timestamp[i] = sim->epoch + now;
     }
+    free(sim);
+}
+
+void
+simulation_loop(particles_t *particles, time_t duration, void (*callback)(time_t timestamp), time_t callback_rate, simulation_options_t const *options)
+{
+    if (options != NULL && options->nb_domains > 1) {
+        domains_loop(particles, duration, callback, callback_rate, options);
+        return;
+    }
+    int time_flow = (duration<0) ? -1 : 1;
+    simulation_t *sim = simulation_new(particles, time_flow, options);
+    if (callback_rate<0)
+        callback_rate *= -1;
+    if (!EQ_TIME_ZERO(callback_rate)) // a callback every `callback_rate`, from time zero
+        for (time_t t = 0; !IS_BEFORE(duration*time_flow, t); t += callback_rate) {
+            simulation_advance_to(sim, t*time_flow);
+            (*callback)(t*time_flow - simulation_epoch(sim));
+        }
+    simulation_advance_to(sim, duration);
+    simulation_destroy(sim);
 }
 
 
 size_t
-load_particles(particle_t *particle_list[], size_t max_count, FILE* file)
+load_particles(particles_t *particles, FILE* file, load_error_t *error)
 {
-    size_t count = 0;
-    size_t i = 0;
-    char buffer[4096];
-    if (fgets(buffer, 4096, file)==NULL) goto err0;
-    if (fscanf(file, "%lu", &count) != 1) goto err0; // get number of particles
-    if (count > max_count) goto err0;
-    for (i = 0; i < count; i++) {
-        particle_t *p = malloc(sizeof *p);
-        particle_list[i] = p;
-        p->timestamp   = 0;
-        p->col_counter = 0;
-        double value;
-        for (size_t d = 0; d < NB_DIM; d++) { // get position
-            if (fscanf(file, "%lf,", &value) != 1) goto err0;
-            p->position[d] = value * loc_UNIT;
-        }
-        for (size_t d = 0; d < NB_DIM; d++) { // get velocity
-            if (fscanf(file, "%lf,", &value) != 1) goto err0;
-            p->velocity[d] = value * loc_UNIT;
-        }
-        if (fscanf(file, "%lf,", &value) != 1) goto err0;
-        p->mass = value * mass_UNIT;
-        if (fscanf(file, "%lf", &value) != 1) goto err0;
-        p->radius = value * loc_UNIT;
-    }
-    return count;
-    err0: while(i>0) free(particle_list[i--]);
-    return 0;
+    return reader_load(particles, file, false, error);
 }
 
 size_t
-load_raw_particles(particle_t *particle_list[], size_t max_count, FILE* file)
+load_raw_particles(particles_t *particles, FILE* file, load_error_t *error)
 {
-    size_t count = 0;
-    size_t i = 0;
-    char buffer[4096];
-    if (fgets(buffer, 4096, file)==NULL) goto err0;
-    if (fscanf(file, "%lu", &count) != 1) goto err0; // get number of particles
-    if (count > max_count) goto err0;
-    for (i = 0; i < count; i++) {
-        particle_t *p = malloc(sizeof *p);
-        particle_list[i] = p;
-        p->timestamp   = 0;
-        p->col_counter = 0;
-        for (size_t d = 0; d < NB_DIM; d++) // get position
-            if (fscanf(file, "%"loc_F",", &(p->position[d])) != 1) goto err0;
-        for (size_t d = 0; d < NB_DIM; d++) // get velocity
-            if (fscanf(file, "%"loc_F",", &(p->velocity[d])) != 1) goto err0;
-        if (fscanf(file, "%"mass_F",%"loc_F, &(p->mass), &(p->radius)) != 2) goto err0;
-    }
-    return count;
-    err0: while(i>0) free(particle_list[i--]);
-    return 0;
+    return reader_load(particles, file, true, error);
 }
 
-void
-generate_particles(particle_t *particle_list[], size_t count, unsigned int seed)
+// random velocity and mass of a generated particle
+static void generate_motion(particle_t *p, unsigned int *seed)
 {
-    const long double MAX_RADIUS = 0.010;
-    const long double MIN_REL_RADIUS = 0.4; // relative to max radius
     const long double MAX_VELOCITY = 0.0005;
     const long double MAX_MASS = 0.8;
     const long double MIN_REL_MASS = 0.5; // relative to max mass
-    particle_t *p = malloc(sizeof *p);
+    p->timestamp   = 0;
+    p->col_counter = 0;
+    do { // uniform repartition in a sphere
+        for (size_t d = 0; d < NB_DIM; d++)
+            p->velocity[d] = ( rand_r(seed)*(2.L*MAX_VELOCITY)/RAND_MAX - MAX_VELOCITY )*loc_UNIT;
+    } while (loc_scal_prod(p->velocity,p->velocity)>MAX_VELOCITY*loc_UNIT*MAX_VELOCITY*loc_UNIT);
+    p->mass = ( MIN_REL_MASS+rand_r(seed)*(1-MIN_REL_MASS)/RAND_MAX )*MAX_MASS*mass_UNIT;
+    // p->color = 1 + rand_r(seed)%7;
+}
+
+void
+generate_particles(particles_t *particles, size_t count, unsigned int seed)
+{
+    const long double MAX_RADIUS = 0.010;
+    const long double MIN_REL_RADIUS = 0.4; // relative to max radius
+    particle_t p;
+    size_t first = particles->count;
+    particles_reserve(particles, first + count);
+    grid_t *grid = grid_new(count, 2*MAX_RADIUS*loc_UNIT); // particles can only overlap in adjacent cells
     size_t i = 0;
     while (i < count) {
         long double radius = ( MIN_REL_RADIUS+rand_r(&seed)*(1-MIN_REL_RADIUS)/RAND_MAX )*MAX_RADIUS;
         for (size_t d = 0; d < NB_DIM; d++)
-            p->position[d] = ( radius + rand_r(&seed)*(1.L-2.L*radius)/RAND_MAX )*loc_UNIT;
-        p->radius = radius*loc_UNIT;
-        for (size_t j = 0; j < i; j++) {
-            if (loc_distance(p->position, particle_list[j]->position) < p->radius+particle_list[j]->radius)
+            p.position[d] = ( radius + rand_r(&seed)*(1.L-2.L*radius)/RAND_MAX )*loc_UNIT;
+        p.radius = radius*loc_UNIT;
+        grid_insert(grid, i, p.position);
+        size_t nb_neighbors;
+        size_t const *neighbors = grid_neighbors(grid, i, &nb_neighbors);
+        for (size_t k = 0; k < nb_neighbors; k++) {
+            size_t j = first + neighbors[k];
+            if (neighbors[k] == i) continue;
+            loc_t sq_dist = 0;
+            for (size_t d = 0; d < NB_DIM; d++) {
+                loc_t diff = p.position[d] - particles->position[d][j];
+                sq_dist += diff * diff;
+            }
+            if (sqrt(sq_dist) < p.radius+particles->radius[j])
                 goto end_loop;
         }
-        if (false) {end_loop: continue;}
-        p->timestamp   = 0;
-        p->col_counter = 0;
-        do { // uniform repartition in a sphere
-            for (size_t d = 0; d < NB_DIM; d++)
-                p->velocity[d] = ( rand_r(&seed)*(2.L*MAX_VELOCITY)/RAND_MAX - MAX_VELOCITY )*loc_UNIT;
-        } while (loc_scal_prod(p->velocity,p->velocity)>MAX_VELOCITY*loc_UNIT*MAX_VELOCITY*loc_UNIT);
-        p->mass = ( MIN_REL_MASS+rand_r(&seed)*(1-MIN_REL_MASS)/RAND_MAX )*MAX_MASS*mass_UNIT;
-        // p->color = 1 + rand_r(&seed)%7;
-        particle_list[i++] = p;
-        p = malloc(sizeof *p);
+        if (false) {end_loop: grid_remove(grid, i); continue;}
+        generate_motion(&p, &seed);
+        particles_add(particles, &p);
+        i++;
     }
-    free(p);
+    grid_deallocate(grid);
 }
 
+long double
+generate_packed_particles(particles_t *particles, size_t count, long double packing_fraction, unsigned int seed)
+{
+    const long double MIN_REL_RADIUS = 0.9; // relative to max radius, close to 1 so that the lattice is filled
+    if (count == 0) return 0;
+    particles_reserve(particles, particles->count + count);
+    // sites of the checkerboard lattice (integer coordinates with an even sum):
+    // a square lattice in 2D and a face-centered cubic lattice in 3D, with neighbors sqrt(2) apart
+    size_t m = (size_t)floorl(powl(2.L*count, 1.L/NB_DIM));
+    size_t nb_tuples;
+    while (true) { // fewest sites per dimention holding every particle
+        nb_tuples = 1;
+        for (size_t d = 0; d < NB_DIM; d++)
+            nb_tuples *= m;
+        if ((nb_tuples+1)/2 >= count) break;
+        m++;
+    }
+    size_t *sites = malloc((nb_tuples+1)/2 * sizeof *sites);
+    size_t nb_sites = 0;
+    for (size_t t = 0; t < nb_tuples; t++) {
+        size_t sum = 0;
+        for (size_t d = 0, code = t; d < NB_DIM; d++, code /= m)
+            sum += code % m;
+        if (sum % 2 == 0)
+            sites[nb_sites++] = t;
+    }
+    // spacing fitting the lattice in the box, with half the distance between neighbors along the walls
+    long double step = 1.L / (m-1 + sqrtl(2.L));
+    long double half_gap = step*sqrtl(2.L)/2;
+    // radius of the biggest particle, so that particles fill the requested fraction of the box
+    long double unit_volume = powl(acosl(-1.L), NB_DIM/2.L) / tgammal(NB_DIM/2.L + 1); // volume of a ball of radius 1
+    long double mean_rel_volume = (1-powl(MIN_REL_RADIUS, NB_DIM+1)) / ((NB_DIM+1)*(1-MIN_REL_RADIUS));
+    long double max_radius = powl(packing_fraction / (count*unit_volume*mean_rel_volume), 1.L/NB_DIM);
+    if (max_radius > half_gap) max_radius = half_gap; // denser than the lattice allows
+    long double volume = 0;
+    particle_t p;
+    for (size_t i = 0; i < count; i++) {
+        size_t k = i + (size_t)rand_r(&seed) % (nb_sites-i); // random site among the free ones
+        size_t site = sites[k];
+        sites[k] = sites[i];
+        long double radius = ( MIN_REL_RADIUS+rand_r(&seed)*(1-MIN_REL_RADIUS)/RAND_MAX )*max_radius;
+        // jitter, small enough to stay half the distance between neighbors away from the site
+        long double jitter = half_gap - radius;
+        long double offset[NB_DIM], sq_norm;
+        do { // uniform repartition in a sphere
+            sq_norm = 0;
+            for (size_t d = 0; d < NB_DIM; d++) {
+                offset[d] = rand_r(&seed)*2.L/RAND_MAX - 1;
+                sq_norm += offset[d]*offset[d];
+            }
+        } while (sq_norm > 1);
+        for (size_t d = 0, code = site; d < NB_DIM; d++, code /= m)
+            p.position[d] = ( half_gap + (code % m)*step + offset[d]*jitter )*loc_UNIT;
+        p.radius = radius*loc_UNIT;
+        volume += unit_volume*powl(radius, NB_DIM);
+        generate_motion(&p, &seed);
+        particles_add(particles, &p);
+    }
+    free(sites);
+    return volume;
+}
 
 void
-export_particles(particle_t *particle_list[], size_t count, FILE* file, char *header)
+export_particles(particles_t const *particles, FILE* file, char *header)
 {
     fprintf(file, "%s\n", (header!=NULL)?header:"no description specified");
-    fprintf(file, "%lu\n", count);
-    for (size_t i = 0; i < count; i++) {
-        particle_t *p = particle_list[i];
+    fprintf(file, "%lu\n", particles->count);
+    for (size_t i = 0; i < particles->count; i++) {
+        for (size_t d = 0; d < NB_DIM; d++) // enough digits to read the same values back
+            fprintf(file, "%.*Lg,", loc_DIG, (long double)(particles->position[d][i]/loc_UNIT));
         for (size_t d = 0; d < NB_DIM; d++)
-            fprintf(file, "%lf,", (double)(p->position[d]/loc_UNIT));
-        for (size_t d = 0; d < NB_DIM; d++)
-            fprintf(file, "%lf,", (double)(p->velocity[d]/loc_UNIT));
-        fprintf(file, "%lf,", (double)(p->mass/mass_UNIT));
-        fprintf(file, "%lf\n", (double)(p->radius/loc_UNIT));
+            fprintf(file, "%.*Lg,", loc_DIG, (long double)(particles->velocity[d][i]/loc_UNIT));
+        fprintf(file, "%.*g,", mass_DIG, (double)(particles->mass[i]/mass_UNIT));
+        fprintf(file, "%.*Lg\n", loc_DIG, (long double)(particles->radius[i]/loc_UNIT));
     }
 }
 
 void
-export_raw_particles(particle_t *particle_list[], size_t count, FILE* file, char *header)
+export_raw_particles(particles_t const *particles, FILE* file, char *header)
 {
     fprintf(file, "%s\n", (header!=NULL)?header:"no description specified");
-    fprintf(file, "%lu\n", count);
-    for (size_t i = 0; i < count; i++) {
-        particle_t *p = particle_list[i];
-        for (size_t d = 0; d < NB_DIM; d++)
-            fprintf(file, "%"loc_F",", p->position[d]);
+    fprintf(file, "%lu\n", particles->count);
+    for (size_t i = 0; i < particles->count; i++) {
+        for (size_t d = 0; d < NB_DIM; d++) // enough digits to read the same values back
+            fprintf(file, "%.*Lg,", loc_DIG, (long double)particles->position[d][i]);
         for (size_t d = 0; d < NB_DIM; d++)
-            fprintf(file, "%"loc_F",", p->velocity[d]);
-        fprintf(file, "%"mass_F",%"loc_F"\n", p->mass, p->radius);
+            fprintf(file, "%.*Lg,", loc_DIG, (long double)particles->velocity[d][i]);
+        fprintf(file, "%.*g,%.*Lg\n", mass_DIG, (double)particles->mass[i], loc_DIG, (long double)particles->radius[i]);
     }
 }
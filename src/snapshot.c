@@ -0,0 +1,229 @@
+#include "snapshot.h"
+#include "mapping.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Characters starting every snapshot. */
+#define SNAPSHOT_MAGIC "PARTSNAP"
+
+/** @brief Value written in native byte order, to detect snapshots of another architecture. */
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+/** @brief Number of arrays in a snapshot: counters, timestamps, positions, velocities, masses and radii. */
+#define NB_ARRAYS (4+2*NB_DIM)
+
+/** @brief The header of a snapshot, at its beginning. */
+typedef struct {
+    /** `SNAPSHOT_MAGIC`, without terminating null character */
+    char     magic[8];
+    /** `SNAPSHOT_VERSION` */
+    uint32_t version;
+    /** `SNAPSHOT_BYTE_ORDER` */
+    uint32_t byte_order;
+    /** The number of dimentions */
+    uint32_t nb_dim;
+    /** The size of a collision counter */
+    uint32_t counter_size;
+    /** The size of a time */
+    uint32_t time_size;
+    /** The size of a location */
+    uint32_t loc_size;
+    /** The size of a mass */
+    uint32_t mass_size;
+    /** Unused, zero */
+    uint32_t reserved;
+    /** The number of particles */
+    uint64_t count;
+    /** The description of the snapshot, null-terminated */
+    char     description[SNAPSHOT_DESCRIPTION_SIZE];
+} header_t;
+
+
+
+static size_t align(size_t offset) {
+    return (offset + SNAPSHOT_ALIGNMENT-1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+// size of the values of each array, in the order of a snapshot
+static void array_sizes(header_t const *header, size_t sizes[NB_ARRAYS]) {
+    size_t k = 0;
+    sizes[k++] = header->counter_size;
+    sizes[k++] = header->time_size;
+    for (size_t d = 0; d < 2*NB_DIM; d++) // positions and velocities
+        sizes[k++] = header->loc_size;
+    sizes[k++] = header->mass_size;
+    sizes[k++] = header->loc_size;
+}
+
+// addresses of the arrays of a store, in the order of a snapshot
+static void store_arrays(particles_t const *ps, void *arrays[NB_ARRAYS]) {
+    size_t k = 0;
+    arrays[k++] = ps->col_counter;
+    arrays[k++] = ps->timestamp;
+    for (size_t d = 0; d < NB_DIM; d++)
+        arrays[k++] = ps->position[d];
+    for (size_t d = 0; d < NB_DIM; d++)
+        arrays[k++] = ps->velocity[d];
+    arrays[k++] = ps->mass;
+    arrays[k++] = ps->radius;
+}
+
+// point the arrays of a store to the given addresses, in the order of a snapshot
+static void store_set_arrays(particles_t *ps, void *arrays[NB_ARRAYS]) {
+    size_t k = 0;
+    ps->col_counter = arrays[k++];
+    ps->timestamp = arrays[k++];
+    for (size_t d = 0; d < NB_DIM; d++)
+        ps->position[d] = arrays[k++];
+    for (size_t d = 0; d < NB_DIM; d++)
+        ps->velocity[d] = arrays[k++];
+    ps->mass = arrays[k++];
+    ps->radius = arrays[k++];
+}
+
+static header_t build_header(size_t count) {
+    header_t header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof header.magic);
+    header.version      = SNAPSHOT_VERSION;
+    header.byte_order   = SNAPSHOT_BYTE_ORDER;
+    header.nb_dim       = NB_DIM;
+    header.counter_size = sizeof(size_t);
+    header.time_size    = sizeof(time_t);
+    header.loc_size     = sizeof(loc_t);
+    header.mass_size    = sizeof(mass_t);
+    header.count        = count;
+    return header;
+}
+
+// copy `count` values of `src_size` bytes to values of `dst_size` bytes,
+// which are unsigned integers or floating numbers
+static bool convert(void *dst, size_t dst_size, void const *src, size_t src_size, size_t count, bool integer) {
+    if (dst_size == src_size) {
+        memcpy(dst, src, count*src_size);
+        return true;
+    }
+    for (size_t i = 0; i < count; i++) {
+        void const *s = (char const *)src + i*src_size;
+        void *t = (char *)dst + i*dst_size;
+        if (integer) {
+            uint64_t value;
+            if (src_size == sizeof(uint32_t)) value = ((uint32_t const *)s)[0];
+            else if (src_size == sizeof(uint64_t)) value = ((uint64_t const *)s)[0];
+            else return false;
+            if (dst_size == sizeof(uint32_t)) ((uint32_t *)t)[0] = value;
+            else if (dst_size == sizeof(uint64_t)) ((uint64_t *)t)[0] = value;
+            else return false;
+        } else {
+            long double value;
+            if (src_size == sizeof(float)) value = ((float const *)s)[0];
+            else if (src_size == sizeof(double)) value = ((double const *)s)[0];
+            else if (src_size == sizeof(long double)) value = ((long double const *)s)[0];
+            else return false;
+            if (dst_size == sizeof(float)) ((float *)t)[0] = value;
+            else if (dst_size == sizeof(double)) ((double *)t)[0] = value;
+            else if (dst_size == sizeof(long double)) ((long double *)t)[0] = value;
+            else return false;
+        }
+    }
+    return true;
+}
+
+// write zeros up to the next alignment
+static bool pad(FILE *file, size_t *offset) {
+    static char const zeros[SNAPSHOT_ALIGNMENT] = {0};
+    size_t gap = align(*offset) - *offset;
+    *offset += gap;
+    return fwrite(zeros, 1, gap, file) == gap;
+}
+
+
+
+bool
+snapshot_check(char const *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    char magic[8];
+    bool ans = fread(magic, 1, sizeof magic, file) == sizeof magic && memcmp(magic, SNAPSHOT_MAGIC, sizeof magic) == 0;
+    fclose(file);
+    return ans;
+}
+
+particles_t *
+snapshot_load(char const *path, char description[SNAPSHOT_DESCRIPTION_SIZE])
+{
+    size_t size;
+    char *data = mapping_open(path, &size);
+    if (data == NULL) return NULL;
+    header_t header;
+    if (size < sizeof header) goto err0;
+    memcpy(&header, data, sizeof header);
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof header.magic) != 0) goto err0;
+    if (header.version != SNAPSHOT_VERSION || header.byte_order != SNAPSHOT_BYTE_ORDER) goto err0;
+    if (header.nb_dim != NB_DIM) goto err0;
+    size_t count = header.count;
+
+    size_t sizes[NB_ARRAYS], build_sizes[NB_ARRAYS];
+    header_t build = build_header(count);
+    array_sizes(&header, sizes);
+    array_sizes(&build, build_sizes);
+    void *arrays[NB_ARRAYS];
+    bool native = true; // same value types as the build
+    size_t end = sizeof header;
+    for (size_t k = 0; k < NB_ARRAYS; k++) {
+        end = align(end);
+        if (sizes[k] == 0 || end > size || count > (size-end)/sizes[k]) goto err0; // truncated
+        arrays[k] = data + end;
+        end += count*sizes[k];
+        native = native && sizes[k] == build_sizes[k];
+    }
+
+    particles_t *ps;
+    if (native) { // use the arrays in place
+        ps = malloc(sizeof *ps);
+        store_set_arrays(ps, arrays);
+        ps->count = ps->capacity = count;
+        ps->mapping = data;
+        ps->mapping_size = size;
+    } else {
+        ps = particles_new(count);
+        void *store[NB_ARRAYS];
+        store_arrays(ps, store);
+        for (size_t k = 0; k < NB_ARRAYS; k++) {
+            if (!convert(store[k], build_sizes[k], arrays[k], sizes[k], count, k == 0)) {
+                particles_deallocate(ps);
+                goto err0;
+            }
+        }
+        ps->count = count;
+        mapping_close(data, size);
+    }
+    if (description != NULL) {
+        memcpy(description, header.description, SNAPSHOT_DESCRIPTION_SIZE);
+        description[SNAPSHOT_DESCRIPTION_SIZE-1] = '\0';
+    }
+    return ps;
+    err0: mapping_close(data, size);
+    return NULL;
+}
+
+bool
+export_snapshot(particles_t const *particles, FILE* file, char const *header_text)
+{
+    header_t header = build_header(particles->count);
+    strncpy(header.description, (header_text!=NULL)?header_text:"no description specified", SNAPSHOT_DESCRIPTION_SIZE-1);
+    if (fwrite(&header, sizeof header, 1, file) != 1) return false;
+    size_t sizes[NB_ARRAYS];
+    void *arrays[NB_ARRAYS];
+    array_sizes(&header, sizes);
+    store_arrays(particles, arrays);
+    size_t offset = sizeof header;
+    for (size_t k = 0; k < NB_ARRAYS; k++) {
+        if (!pad(file, &offset)) return false;
+        if (fwrite(arrays[k], sizes[k], particles->count, file) != particles->count) return false;
+        offset += particles->count*sizes[k];
+    }
+    return true;
+}
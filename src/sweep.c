@@ -0,0 +1,260 @@
+#include "sweep.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Size above which a box is large, relative to the mean size of the boxes. */
+#define SWEEP_LARGE 4
+
+struct sweep {
+    /** The number of registered particles */
+    size_t  nb_part;
+    /** The distance between the center of a box and its faces, minus the radius */
+    loc_t   margin;
+    /** The greatest half width of a box which is not large */
+    loc_t   max_half_width;
+    /** The center of the box of each particle, along each dimention */
+    loc_t  *center[NB_DIM];
+    /** The half width of the box of each particle: its radius and the margin */
+    loc_t  *half_width;
+    /** The particles sorted by the center of their box, along each dimention */
+    size_t *order[NB_DIM];
+    /** The position of each particle in `order`, along each dimention */
+    size_t *rank[NB_DIM];
+    /** Is the box of each particle much larger than the others? */
+    bool   *large;
+    /** The particles with a large box, checked by every query instead of being swept */
+    size_t *larges;
+    /** The number of particles with a large box */
+    size_t  nb_larges;
+    /** Are `order`, `rank` and large boxes up to date with the registered particles? */
+    bool    sorted;
+    /** The indexes returned by the last neighbors query */
+    size_t *buffer;
+    /** The number of cells allocated in `buffer` */
+    size_t  buffer_capacity;
+};
+
+/** @brief A box to sort, by the center along a dimention. */
+typedef struct {
+    loc_t  center;
+    size_t i;
+} sort_item_t;
+
+
+
+static int compare_items(void const *item1, void const *item2) {
+    loc_t c1 = ((sort_item_t const *)item1)->center;
+    loc_t c2 = ((sort_item_t const *)item2)->center;
+    return (c1 > c2) - (c1 < c2);
+}
+
+static void sort(sweep_t *s) {
+    // a few large boxes would widen every sweep: they are checked apart
+    loc_t sum_half_width = 0;
+    for (size_t i = 0; i < s->nb_part; i++)
+        sum_half_width += s->half_width[i];
+    loc_t limit = SWEEP_LARGE*sum_half_width/s->nb_part;
+    s->max_half_width = 0;
+    s->nb_larges = 0;
+    for (size_t i = 0; i < s->nb_part; i++) {
+        s->large[i] = s->half_width[i] > limit;
+        if (s->large[i])
+            s->larges[s->nb_larges++] = i;
+        else if (s->half_width[i] > s->max_half_width)
+            s->max_half_width = s->half_width[i];
+    }
+    sort_item_t *items = malloc(s->nb_part * sizeof *items);
+    for (size_t d = 0; d < NB_DIM; d++) {
+        for (size_t i = 0; i < s->nb_part; i++)
+            items[i] = (sort_item_t){s->center[d][i], i};
+        qsort(items, s->nb_part, sizeof *items, &compare_items);
+        for (size_t k = 0; k < s->nb_part; k++) {
+            s->order[d][k] = items[k].i;
+            s->rank[d][items[k].i] = k;
+        }
+    }
+    free(items);
+    s->sorted = true;
+}
+
+// first position in `order[d]` whose center is not lower than `c`
+static size_t lower_bound(sweep_t const *s, size_t d, loc_t c) {
+    size_t lo = 0, hi = s->nb_part;
+    while (lo < hi) {
+        size_t mid = lo + (hi-lo)/2;
+        if (s->center[d][s->order[d][mid]] < c)
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// positions in `order[d]` of the boxes which may overlap the box of i along `d`
+static void window(sweep_t const *s, size_t i, size_t d, size_t *first, size_t *last) {
+    loc_t reach = s->half_width[i] + s->max_half_width;
+    *first = lower_bound(s, d, s->center[d][i] - reach);
+    *last = lower_bound(s, d, s->center[d][i] + reach);
+    while (*last < s->nb_part && s->center[d][s->order[d][*last]] <= s->center[d][i] + reach)
+        (*last)++; // include boxes exactly at reach
+}
+
+// dimention along which the fewest boxes may overlap the box of i, with their positions in `order`
+static size_t sweep_dim(sweep_t const *s, size_t i, size_t *first, size_t *last) {
+    size_t best = 0;
+    window(s, i, 0, first, last);
+    for (size_t d = 1; d < NB_DIM; d++) {
+        size_t lo, hi;
+        window(s, i, d, &lo, &hi);
+        if (hi-lo < *last-*first) {
+            best = d;
+            *first = lo;
+            *last = hi;
+        }
+    }
+    return best;
+}
+
+// do the boxes of i and j overlap along a dimention, with a given center for i?
+static bool overlap_along(sweep_t const *s, size_t i, size_t j, size_t d, loc_t center) {
+    loc_t diff = center - s->center[d][j];
+    loc_t lim = s->half_width[i] + s->half_width[j];
+    return -lim <= diff && diff <= lim;
+}
+
+static bool overlap(sweep_t const *s, size_t i, size_t j) {
+    for (size_t d = 0; d < NB_DIM; d++)
+        if (!overlap_along(s, i, j, d, s->center[d][i]))
+            return false;
+    return true;
+}
+
+static void push(sweep_t *s, size_t *count, size_t j) {
+    if (*count == s->buffer_capacity) {
+        s->buffer_capacity = (s->buffer_capacity==0) ? 64 : 2*s->buffer_capacity;
+        s->buffer = realloc(s->buffer, s->buffer_capacity * sizeof *s->buffer);
+    }
+    s->buffer[(*count)++] = j;
+}
+
+// particles whose box overlaps the box of i, but not its box centered on `old_center` along `dim` (if `dim < NB_DIM`)
+static size_t const *query(sweep_t *s, size_t i, size_t dim, loc_t old_center, size_t *count) {
+    if (!s->sorted) sort(s);
+    size_t first, last;
+    size_t d = sweep_dim(s, i, &first, &last);
+    *count = 0;
+    for (size_t k = first; k < last; k++) { // sweep
+        size_t j = s->order[d][k];
+        if (s->large[j] || !overlap(s, i, j)) continue; // prune
+        if (dim < NB_DIM && overlap_along(s, i, j, dim, old_center)) continue;
+        push(s, count, j);
+    }
+    for (size_t k = 0; k < s->nb_larges; k++) {
+        size_t j = s->larges[k];
+        if (!overlap(s, i, j)) continue;
+        if (dim < NB_DIM && overlap_along(s, i, j, dim, old_center)) continue;
+        push(s, count, j);
+    }
+    return s->buffer;
+}
+
+
+
+sweep_t *
+sweep_new(size_t nb_part, loc_t margin)
+{
+    sweep_t *s = malloc(sizeof *s);
+    *s = (sweep_t){0, margin, 0, {NULL}, malloc(nb_part * sizeof *s->half_width), {NULL}, {NULL},
+                   malloc(nb_part * sizeof *s->large), malloc(nb_part * sizeof *s->larges), 0, false, NULL, 0};
+    for (size_t d = 0; d < NB_DIM; d++) {
+        s->center[d] = malloc(nb_part * sizeof *s->center[d]);
+        s->order[d] = malloc(nb_part * sizeof *s->order[d]);
+        s->rank[d] = malloc(nb_part * sizeof *s->rank[d]);
+    }
+    return s;
+}
+
+void
+sweep_insert(sweep_t *s, size_t i, loc_t const position[NB_DIM], loc_t radius)
+{
+    for (size_t d = 0; d < NB_DIM; d++)
+        s->center[d][i] = position[d];
+    s->half_width[i] = radius + s->margin;
+    if (!s->sorted || i < s->nb_part) { // sorted at the next query
+        if (i >= s->nb_part)
+            s->nb_part = i+1;
+        s->sorted = false;
+        return;
+    }
+    // registered after a query: inserted in place, or checked apart if it would widen every sweep
+    s->large[i] = s->half_width[i] > s->max_half_width;
+    if (s->large[i])
+        s->larges[s->nb_larges++] = i;
+    for (size_t d = 0; d < NB_DIM; d++) {
+        size_t k = lower_bound(s, d, position[d]);
+        memmove(&s->order[d][k+1], &s->order[d][k], (s->nb_part-k) * sizeof *s->order[d]);
+        s->order[d][k] = i;
+        for (size_t r = k; r <= s->nb_part; r++)
+            s->rank[d][s->order[d][r]] = r;
+    }
+    s->nb_part++;
+}
+
+void
+sweep_move(sweep_t *s, size_t i, size_t dim, int dir)
+{
+    loc_t *center = s->center[dim];
+    size_t *order = s->order[dim], *rank = s->rank[dim];
+    center[i] += dir*s->margin;
+    if (!s->sorted) return;
+    size_t k = rank[i];
+    while (k+1 < s->nb_part && center[order[k+1]] < center[i]) { // insertion sort, forward
+        order[k] = order[k+1];
+        rank[order[k]] = k;
+        k++;
+    }
+    while (k > 0 && center[order[k-1]] > center[i]) { // insertion sort, backward
+        order[k] = order[k-1];
+        rank[order[k]] = k;
+        k--;
+    }
+    order[k] = i;
+    rank[i] = k;
+}
+
+loc_t
+sweep_face(sweep_t const *s, size_t i, size_t dim, int dir)
+{
+    loc_t face = s->center[dim][i] + dir*s->margin;
+    loc_t radius = s->half_width[i] - s->margin;
+    if (face < radius || loc_UNIT-radius < face) return NEVER; // the wall comes first
+    return face;
+}
+
+size_t const *
+sweep_neighbors(sweep_t *s, size_t i, size_t *count)
+{
+    return query(s, i, NB_DIM, 0, count);
+}
+
+size_t const *
+sweep_new_neighbors(sweep_t *s, size_t i, size_t dim, int dir, size_t *count)
+{
+    return query(s, i, dim, s->center[dim][i] - dir*s->margin, count);
+}
+
+void
+sweep_deallocate(sweep_t *s)
+{
+    for (size_t d = 0; d < NB_DIM; d++) {
+        free(s->center[d]);
+        free(s->order[d]);
+        free(s->rank[d]);
+    }
+    free(s->half_width);
+    free(s->large);
+    free(s->larges);
+    free(s->buffer);
+    free(s);
+}
@@ -23,12 +23,15 @@ int main(int argc, char const *argv[]) {
     }
 
     // pre-create dummies
-    dummy_t dummies[MAX_NB];
+    dummy_t *dummies = malloc(MAX_NB * sizeof *dummies); // too big for the stack
     for (size_t i = 0; i < MAX_NB; i++) {
         dummies[i].key = i;
         dummies[i].value = NULL;
     }
     dummies[0].key += 0;
+    void **values = malloc(MAX_NB * sizeof *values);
+    for (size_t i = 0; i < MAX_NB; i++)
+        values[i] = dummies + (MAX_NB-1-i); // worst order for bulk insertion
 
     for (size_t nb = MIN_NB; nb <= MAX_NB; nb = nb*5/4) {
         heap_t *dummy_heap = heap_new(&compare_dummies, NULL);
@@ -49,11 +52,21 @@ int main(int argc, char const *argv[]) {
         double extract_time = (double) (end - start) / CLOCKS_PER_SEC;
 
         heap_deallocate(dummy_heap);
-        fprintf(out, "%lu,%lf,%lf\n", nb, insert_time, extract_time);
+
+        dummy_heap = heap_new(&compare_dummies, NULL);
+        start = clock();
+        heap_insert_bulk(dummy_heap, values, nb);
+        end = clock();
+        double bulk_time = (double) (end - start) / CLOCKS_PER_SEC;
+
+        heap_deallocate(dummy_heap);
+        fprintf(out, "%lu,%lf,%lf,%lf\n", nb, insert_time, extract_time, bulk_time);
     }
 
     fclose(out);
     out = NULL;
+    free(dummies);
+    free(values);
 
     return 0;
 }
@@ -4,6 +4,35 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <stddef.h>
+
+/** @brief A dummy structure ordered by an embedded key. */
+typedef struct {
+    size_t     id;
+    heap_key_t key;
+} keyed_dummy_t;
+
+// order dummies of equal keys by their id
+static int compare_ids(void *dummy1, void *dummy2) {
+    keyed_dummy_t *kd1 = dummy1, *kd2 = dummy2;
+    return (kd1->id > kd2->id) - (kd1->id < kd2->id);
+}
+
+// keep dummies with an even id, releasing the others
+static bool keep_even(void *dummy, void *data) {
+    keyed_dummy_t *kd = dummy;
+    if (kd->id % 2 == 0) return true;
+    (*(size_t *)data)++;
+    free(kd);
+    return false;
+}
+
+// keep every dummy, reversing the order of their keys
+static bool reverse_key(void *dummy, void *data) {
+    keyed_dummy_t *kd = dummy;
+    kd->key = 100 - kd->key;
+    return true;
+}
 
 static void dealloc_dummy(void *dummy) {
     dummy_t *d = dummy;
@@ -38,8 +67,86 @@ int main(void) {
         free(d);
     }
 
+    dummy_t *bulk[50];
+    for (size_t i = 0; i < 50; i++) {
+        bulk[i] = malloc(sizeof *bulk[i]);
+        bulk[i]->key = rand_r(&seed)*50.0/RAND_MAX;
+        if (asprintf(&(bulk[i]->value), "bulk dummy #%lu", i)<0) return 1;
+    }
+    heap_insert_bulk(dummy_heap, (void **)bulk, 50);
+
+    k = -INFINITY;
+    while ((d=heap_extract_min(dummy_heap)) != NULL) {
+        printf("extract <%s>\tkey=%lf\n", d->value, d->key);
+        if (d->key < k) {
+            printf("ERROR: %f < %f!\n", d->key, k);
+            printf("====================\n");
+            return 1;
+        }
+        k = d->key;
+        free(d->value);
+        free(d);
+    }
+
     heap_deallocate(dummy_heap);
 
+    heap_t *keyed_heap = heap_new_keyed(offsetof(keyed_dummy_t, key), &compare_ids, &free);
+    keyed_dummy_t *kd;
+    for (size_t i = 0; i < 50; i++) {
+        kd = malloc(sizeof *kd);
+        kd->id = i;
+        kd->key = rand_r(&seed)%50;
+        heap_insert(keyed_heap, kd);
+    }
+    keyed_dummy_t *keyed_bulk[50];
+    for (size_t i = 0; i < 50; i++) {
+        keyed_bulk[i] = malloc(sizeof *keyed_bulk[i]);
+        keyed_bulk[i]->id = 50+i;
+        keyed_bulk[i]->key = rand_r(&seed)%50;
+    }
+    heap_insert_bulk(keyed_heap, (void **)keyed_bulk, 50);
+
+    size_t nb_released = 0;
+    size_t removed = heap_filter(keyed_heap, &keep_even, &nb_released);
+    if (removed != 50 || nb_released != 50 || heap_size(keyed_heap) != 50) {
+        printf("ERROR: %lu values filtered out of 100!\n", removed);
+        printf("====================\n");
+        return 1;
+    }
+
+    // keys changed by the predicate are read again
+    if (heap_filter(keyed_heap, &reverse_key, NULL) != 0 || heap_size(keyed_heap) != 50) {
+        printf("ERROR: values filtered out while changing their keys!\n");
+        printf("====================\n");
+        return 1;
+    }
+
+    heap_key_t kk = 0;
+    size_t kid = 0;
+    for (size_t i = 0; i < 40; i++) { // leave values for deallocation
+        kd = heap_extract_min(keyed_heap);
+        printf("extract <keyed dummy #%lu>\tkey=%lu\n", kd->id, (unsigned long)kd->key);
+        if (kd->key < kk) {
+            printf("ERROR: %lu < %lu!\n", (unsigned long)kd->key, (unsigned long)kk);
+            printf("====================\n");
+            return 1;
+        }
+        if (kd->key == kk && kd->id < kid) {
+            printf("ERROR: tie of key %lu broken with #%lu after #%lu!\n", (unsigned long)kk, kd->id, kid);
+            printf("====================\n");
+            return 1;
+        }
+        if (kd->id % 2 != 0) {
+            printf("ERROR: filtered value #%lu extracted!\n", kd->id);
+            printf("====================\n");
+            return 1;
+        }
+        kk = kd->key;
+        kid = kd->id;
+        free(kd);
+    }
+    heap_deallocate(keyed_heap);
+
     printf("OK!\n");
 
     printf("====================\n");
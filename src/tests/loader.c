@@ -1,8 +1,67 @@
 #include "simulation.h"
+#include "snapshot.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
 
-#define MAX_PARTICLES 10000
+// are the particles of two stores the same, except for the timestamps and counters if `exact` is false?
+static bool same_particles(particles_t const *ps1, particles_t const *ps2, bool exact) {
+    for (size_t i = 0; i < ps1->count; i++) {
+        particle_t p = particles_get(ps1, i), q = particles_get(ps2, i);
+        bool same = p.mass == q.mass && p.radius == q.radius;
+        if (exact)
+            same = same && p.col_counter == q.col_counter && p.timestamp == q.timestamp;
+        for (size_t d = 0; d < NB_DIM; d++)
+            same = same && p.position[d] == q.position[d] && p.velocity[d] == q.velocity[d];
+        if (!same) {
+            fprintf(stderr, "Particle %lu differs!\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+// export particles as text and load them back, which must give the same values
+static void check_text(particles_t const *particles) {
+    FILE *text_file = tmpfile();
+    if (text_file == NULL) {
+        fprintf(stderr, "Cannot write a temporary file!\n");
+        exit(EXIT_FAILURE);
+    }
+    export_particles(particles, text_file, "<file written with test-loader>");
+    rewind(text_file);
+    particles_t *loaded = particles_new(0);
+    load_error_t error;
+    load_particles(loaded, text_file, &error);
+    fclose(text_file);
+    if (error.reason != NULL || loaded->count != particles->count || !same_particles(particles, loaded, false)) {
+        fprintf(stderr, "Exported text is not loaded back without loss!\n");
+        exit(EXIT_FAILURE);
+    }
+    particles_deallocate(loaded);
+}
+
+// write particles to a snapshot and load them back, which must give the same values
+static void check_snapshot(particles_t const *particles, char const *path) {
+    FILE *snapshot_file = fopen(path, "wb");
+    if (snapshot_file == NULL || !export_snapshot(particles, snapshot_file, "<file written with test-loader>")) {
+        fprintf(stderr, "Cannot write snapshot %s!\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fclose(snapshot_file);
+    char description[SNAPSHOT_DESCRIPTION_SIZE];
+    particles_t *loaded = snapshot_load(path, description);
+    if (loaded == NULL || loaded->count != particles->count || strcmp(description, "<file written with test-loader>") != 0) {
+        fprintf(stderr, "Cannot load snapshot %s!\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if (!same_particles(particles, loaded, true)) {
+        fprintf(stderr, "Snapshot %s differs!\n", path);
+        exit(EXIT_FAILURE);
+    }
+    particles_deallocate(loaded);
+}
 
 int main(int argc, char const *argv[]) {
     FILE *input_file = stdin;
@@ -14,17 +73,28 @@ int main(int argc, char const *argv[]) {
         }
     }
 
-    particle_t *particle_list[MAX_PARTICLES];
-    size_t count = load_particles(particle_list, MAX_PARTICLES, input_file);
+    particles_t *particles = particles_new(0);
+    load_error_t error;
+    load_particles(particles, input_file, &error);
+    if (error.reason != NULL) {
+        reader_print_error((argc>1) ? argv[1] : "stdin", &error, stderr);
+        exit(EXIT_FAILURE);
+    }
 
     fclose(input_file);
     input_file = NULL;
 
-    export_particles(particle_list, count, stdout, "<file read with test-loader>");
+    if (argc>2) // round trip through a binary snapshot
+        check_snapshot(particles, argv[2]);
+    check_text(particles); // round trip through the text format
+    particles_t *generated = particles_new(0); // values which are not short decimals
+    generate_particles(generated, 1000, 6502);
+    check_text(generated);
+    particles_deallocate(generated);
 
-    for (size_t i = 0; i < count; i++) {
-        free(particle_list[i]);
-    }
+    export_particles(particles, stdout, "<file read with test-loader>");
+
+    particles_deallocate(particles);
 
     return 0;
 }
@@ -1,47 +1,52 @@
+#define _POSIX_C_SOURCE 199506L
 #define NB_DIM 2
 #define time_EPS 1e-6
 #define loc_EPS 1e-6
 #include "particle.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #undef NDEBUG
 #include <assert.h>
 
-particle_t *
-new_test_particle(float px, float py, float vx, float vy, float m, float r)
+size_t
+new_test_particle(particles_t *ps, float px, float py, float vx, float vy, float m, float r)
 {
-    particle_t *particle = malloc(sizeof *particle);
-    particle->position[0] = px*loc_UNIT;
-    particle->position[1] = py*loc_UNIT;
-    particle->velocity[0] = vx*loc_UNIT;
-    particle->velocity[1] = vy*loc_UNIT;
-    particle->mass        = m*mass_UNIT;
-    particle->radius      = r*loc_UNIT;
-    particle->timestamp   = 0;
-    particle->col_counter = 0;
-    return particle;
+    particle_t particle;
+    particle.position[0] = px*loc_UNIT;
+    particle.position[1] = py*loc_UNIT;
+    particle.velocity[0] = vx*loc_UNIT;
+    particle.velocity[1] = vy*loc_UNIT;
+    particle.mass        = m*mass_UNIT;
+    particle.radius      = r*loc_UNIT;
+    particle.timestamp   = 0;
+    particle.col_counter = 0;
+    return particles_add(ps, &particle);
 }
 
 void
-check_collision_hplane(particle_t const *p, size_t dim,
+check_collision_hplane(particles_t const *ps, size_t p, size_t dim,
                        float time2col,
                        float new_vx, float new_vy)
 {
-    particle_t p_temp = *p; // clone particle
-    time_t t1 = time_before_crossing_hplane(&p_temp, dim, 0*loc_UNIT); // first wall
-    time_t t2 = time_before_crossing_hplane(&p_temp, dim, 1*loc_UNIT); // second wall
+    particles_t *ps_temp = particles_clone(ps); // clone particles
+    time_t t1 = time_before_crossing_hplane(ps_temp, p, dim, 0*loc_UNIT); // first wall
+    time_t t2 = time_before_crossing_hplane(ps_temp, p, dim, 1*loc_UNIT); // second wall
     time_t t = NEVER;
     if (IS_FUTURE_TIME(t1) && IS_BEFORE(t1, t)) t = t1;
     if (IS_FUTURE_TIME(t2) && IS_BEFORE(t2, t)) t = t2;
     if (!isfinite(time2col)) {
         printf("%15.8s\n", "INFINITY");
         assert(!IS_FUTURE_TIME(t));
+        particles_deallocate(ps_temp);
         return;
     }
     assert(EQ_TIME_ZERO(t/time_UNIT-time2col));
-    update(&p_temp, t);
-    collide_hplane(&p_temp, dim);
+    update(ps_temp, p, t);
+    collide_hplane(ps_temp, p, dim);
+    particle_t p_temp = particles_get(ps_temp, p);
+    particles_deallocate(ps_temp);
     printf("%15.2f    (%9.6f, %9.6f)    (%9.6f, %9.6f)\n",
            (float)(t/time_UNIT),
            (float)((float)p_temp.velocity[0]/loc_UNIT),
@@ -53,23 +58,26 @@ check_collision_hplane(particle_t const *p, size_t dim,
 }
 
 void
-check_collision_particle(particle_t const *p1, particle_t const *p2,
+check_collision_particle(particles_t const *ps, size_t p1, size_t p2,
                           float time2col,
                           float new_v1x, float new_v1y,
                           float new_v2x, float new_v2y)
 {
-    particle_t p1_temp = *p1; // clone particle
-    particle_t p2_temp = *p2; // clone particle
-    time_t t = time_before_contact(&p1_temp, &p2_temp);
+    particles_t *ps_temp = particles_clone(ps); // clone particles
+    time_t t = time_before_contact(ps_temp, p1, p2);
     if (!IS_FUTURE_TIME(time2col)) {
         printf("%15.8s\n", "INFINITY");
         assert(!IS_FUTURE_TIME(t));
+        particles_deallocate(ps_temp);
         return;
     }
     assert(EQ_TIME_ZERO(t/time_UNIT-time2col));
-    update(&p1_temp, t);
-    update(&p2_temp, t);
-    collide_particle(&p1_temp, &p2_temp);
+    update(ps_temp, p1, t);
+    update(ps_temp, p2, t);
+    collide_particle(ps_temp, p1, p2);
+    particle_t p1_temp = particles_get(ps_temp, p1);
+    particle_t p2_temp = particles_get(ps_temp, p2);
+    particles_deallocate(ps_temp);
     printf("%15.2f    (%9.6f, %9.6f)    (%9.6f, %9.6f)\n",
            (float)(t/time_UNIT),
            (float)((float)p1_temp.velocity[0]/loc_UNIT),
@@ -88,54 +96,156 @@ check_collision_particle(particle_t const *p1, particle_t const *p2,
     assert(EQ_LOC_ZERO((float)p2_temp.velocity[1]/loc_UNIT-new_v2y));
 }
 
+void
+check_contacts_batch(particles_t const *ps, int time_flow)
+{
+    size_t n = ps->count;
+    size_t *candidates = malloc(n * sizeof *candidates);
+    size_t *hits = malloc(n * sizeof *hits);
+    time_t *times = malloc(n * sizeof *times);
+    for (size_t j = 0; j < n; j++)
+        candidates[j] = j;
+    size_t nb_hits_total = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t nb_hits = time_before_contacts(ps, i, candidates, n, time_flow, hits, times);
+        size_t h = 0;
+        for (size_t j = 0; j < n; j++) { // same computation, pair by pair
+            size_t ref = (IS_BEFORE(ps->timestamp[i]*time_flow, ps->timestamp[j]*time_flow)) ? j : i;
+            time_t t = time_before_contact(ps, ref, (ref==i) ? j : i) * time_flow;
+            if (h < nb_hits && hits[h] == j) {
+                assert(IS_FUTURE_TIME(t));
+                assert(times[h] == t + ps->timestamp[ref]*time_flow); // bit-identical
+                h++;
+                continue;
+            }
+            if (j == i || !IS_FUTURE_TIME(t)) continue;
+            // only pairs moving apart may be rejected
+            particle_t p1 = particles_get(ps, ref);
+            particle_t p2 = particles_get(ps, (ref==i) ? j : i);
+            loc_t dpos[NB_DIM];
+            loc_t dvel[NB_DIM];
+            particles_position_at(ps, (ref==i) ? j : i, p1.timestamp, dpos);
+            loc_delta(dpos, p1.position, dpos);
+            loc_delta(p2.velocity, p1.velocity, dvel);
+            assert(loc_scal_prod(dpos, dvel)*time_flow >= 0);
+        }
+        assert(h == nb_hits);
+        nb_hits_total += nb_hits;
+    }
+    printf("%15lu contacts found among %lu pairs\n", nb_hits_total, n*n);
+    free(candidates);
+    free(hits);
+    free(times);
+}
+
+void
+check_kernels(unsigned int *seed)
+{
+    for (size_t n = 0; n < 1000; n++) {
+        loc_t loc1[NB_DIM], loc2[NB_DIM], ans[NB_DIM], appended[NB_DIM];
+        loc_t scal_prod = 0, sq_dist = 0;
+        loc_t coeff = rand_r(seed)/(loc_t)RAND_MAX;
+        for (size_t d = 0; d < NB_DIM; d++) { // same computation, with generic loops
+            loc1[d] = rand_r(seed)/(loc_t)RAND_MAX-.5;
+            loc2[d] = rand_r(seed)/(loc_t)RAND_MAX-.5;
+            appended[d] = loc1[d] + loc2[d]*coeff;
+            scal_prod += loc1[d] * loc2[d];
+            sq_dist += (loc1[d]-loc2[d]) * (loc1[d]-loc2[d]);
+        }
+        assert(loc_scal_prod(loc1, loc2) == scal_prod); // bit-identical
+        assert(loc_distance(loc1, loc2) == sqrt(sq_dist));
+        loc_delta(loc1, loc2, ans);
+        for (size_t d = 0; d < NB_DIM; d++)
+            assert(ans[d] == loc1[d]-loc2[d]);
+        loc_append(loc1, loc2, coeff);
+        for (size_t d = 0; d < NB_DIM; d++)
+            assert(loc1[d] == appended[d]);
+    }
+    printf("%15d dimensions OK\n", NB_DIM);
+}
+
+// fill a store from empty, which must keep every particle while it grows
+static void check_growth(size_t count)
+{
+    particles_t *ps = particles_new(0);
+    for (size_t i = 0; i < count; i++)
+        assert(new_test_particle(ps, i/(float)count, .5, .0, .0, 0.5, 1e-3) == i);
+    assert(ps->count == count && ps->capacity >= count);
+    assert(particles_reserve(ps, count/2) && ps->capacity >= count); // never shrinks
+    size_t capacity = 4*ps->capacity;
+    assert(particles_reserve(ps, capacity) && ps->capacity == capacity);
+    assert(!particles_reserve(ps, SIZE_MAX/2) && ps->capacity == capacity); // sizes would wrap around
+    for (size_t i = 0; i < count; i++)
+        assert(ps->position[0][i] == (loc_t)(i/(float)count)*loc_UNIT);
+    printf("%15lu particles OK, %lu bytes\n", count, particles_memory(ps->capacity));
+    particles_deallocate(ps);
+}
+
 int
 main(void)
 {
     printf("====================\n");
     printf("generating particles...\n");
-    particle_t *p1 = new_test_particle(.25, .25,  .50,  .00, 0.5, 1e-2);
-    particle_t *p2 = new_test_particle(.25, .25, -.50,  .00, 0.5, 1e-2);
-    particle_t *p3 = new_test_particle(.25, .25,  .00,  .50, 0.5, 1e-2);
-    particle_t *p4 = new_test_particle(.25, .25,  .00, -.50, 0.5, 1e-2);
-    particle_t *p5 = new_test_particle(.25, .25,  .25, -.40, 0.5, 1e-2);
-    particle_t *p6 = new_test_particle(.50, .25,  .00,  .00, 0.8, 5e-3);
-    particle_t *p7 = new_test_particle(.75, .25, -.25,  .00, 0.5, 1e-2);
-    particle_t *p8 = new_test_particle(.60, .80,  .25, -.40, 0.8, 5e-3);
+    particles_t *ps = particles_new(8);
+    size_t p1 = new_test_particle(ps, .25, .25,  .50,  .00, 0.5, 1e-2);
+    size_t p2 = new_test_particle(ps, .25, .25, -.50,  .00, 0.5, 1e-2);
+    size_t p3 = new_test_particle(ps, .25, .25,  .00,  .50, 0.5, 1e-2);
+    size_t p4 = new_test_particle(ps, .25, .25,  .00, -.50, 0.5, 1e-2);
+    size_t p5 = new_test_particle(ps, .25, .25,  .25, -.40, 0.5, 1e-2);
+    size_t p6 = new_test_particle(ps, .50, .25,  .00,  .00, 0.8, 5e-3);
+    size_t p7 = new_test_particle(ps, .75, .25, -.25,  .00, 0.5, 1e-2);
+    size_t p8 = new_test_particle(ps, .60, .80,  .25, -.40, 0.8, 5e-3);
     printf("====================\n");
     printf("testing collisions with vertical walls...\n");
     printf("%-17.17s  %-22.12s    %-22.12s\n", "time to collision", "new velocity", "new position");
-    check_collision_hplane(p1, 0,  1.48, -.50,  .00);
-    check_collision_hplane(p2, 0,  0.48,  .50,  .00);
-    check_collision_hplane(p3, 0, NEVER,    0,    0);
-    check_collision_hplane(p4, 0, NEVER,    0,    0);
-    check_collision_hplane(p5, 0,  2.96, -.25, -.40);
+    check_collision_hplane(ps, p1, 0,  1.48, -.50,  .00);
+    check_collision_hplane(ps, p2, 0,  0.48,  .50,  .00);
+    check_collision_hplane(ps, p3, 0, NEVER,    0,    0);
+    check_collision_hplane(ps, p4, 0, NEVER,    0,    0);
+    check_collision_hplane(ps, p5, 0,  2.96, -.25, -.40);
     printf("OK!\n");
     printf("====================\n");
     printf("testing collisions with horizontal walls...\n");
     printf("%-17.17s  %-22.12s    %-22.12s\n", "time to collision", "new velocity", "new position");
-    check_collision_hplane(p1, 1, NEVER,    0,    0);
-    check_collision_hplane(p2, 1, NEVER,    0,    0);
-    check_collision_hplane(p3, 1,  1.48,  .00, -.50);
-    check_collision_hplane(p4, 1,  0.48,  .00,  .50);
-    check_collision_hplane(p5, 1,  0.60,  .25,  .40);
+    check_collision_hplane(ps, p1, 1, NEVER,    0,    0);
+    check_collision_hplane(ps, p2, 1, NEVER,    0,    0);
+    check_collision_hplane(ps, p3, 1,  1.48,  .00, -.50);
+    check_collision_hplane(ps, p4, 1,  0.48,  .00,  .50);
+    check_collision_hplane(ps, p5, 1,  0.60,  .25,  .40);
     printf("OK!\n");
     printf("====================\n");
     printf("testing collisions between particles...\n");
     printf("%-17.17s  %-22.12s    %-22.12s\n", "time to collision", "new velocity", "new position");
-    check_collision_particle(p1, p6, 0.470000, -.115385,  .000000,  .384615,  .000000);
-    check_collision_particle(p1, p7, 0.640000, -.250000,  .000000,  .500000,  .000000);
-    check_collision_particle(p1, p8, 1.352274,  .067993, -.329141,  .520004, -.194287);
-    check_collision_particle(p7, p8,    NEVER,        0,        0,        0,        0);
+    check_collision_particle(ps, p1, p6, 0.470000, -.115385,  .000000,  .384615,  .000000);
+    check_collision_particle(ps, p1, p7, 0.640000, -.250000,  .000000,  .500000,  .000000);
+    check_collision_particle(ps, p1, p8, 1.352274,  .067993, -.329141,  .520004, -.194287);
+    check_collision_particle(ps, p7, p8,    NEVER,        0,        0,        0,        0);
+    printf("OK!\n");
+    printf("====================\n");
+    printf("testing batched contact times...\n");
+    unsigned int seed = 42;
+    particles_t *batch = particles_new(300);
+    for (size_t i = 0; i < 300; i++) { // random particles, with snapshots at different times
+        new_test_particle(batch, rand_r(&seed)/(float)RAND_MAX, rand_r(&seed)/(float)RAND_MAX,
+                          rand_r(&seed)/(float)RAND_MAX-.5, rand_r(&seed)/(float)RAND_MAX-.5,
+                          0.5, 1e-2);
+        batch->timestamp[i] = rand_r(&seed)%4*time_UNIT;
+    }
+    check_contacts_batch(batch,  1);
+    check_contacts_batch(batch, -1);
+    particles_deallocate(batch);
+    printf("OK!\n");
+    printf("====================\n");
+    printf("testing store growth...\n");
+    check_growth(1);
+    check_growth(1000);
+    printf("OK!\n");
+    printf("====================\n");
+    printf("testing vector kernels...\n");
+    check_kernels(&seed);
     printf("OK!\n");
     printf("====================\n");
-    free(p1);
-    free(p2);
-    free(p3);
-    free(p4);
-    free(p5);
-    free(p6);
-    free(p7);
-    free(p8);
+    particles_deallocate(ps);
     printf("TEST OK!\n");
     printf("====================\n");
     return 0;
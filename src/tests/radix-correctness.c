@@ -0,0 +1,155 @@
+#define _POSIX_C_SOURCE 199506L
+#include "radix.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/** @brief A dummy structure ordered by an embedded key. */
+typedef struct {
+    size_t     id;
+    heap_key_t key;
+} keyed_dummy_t;
+
+static keyed_dummy_t *new_dummy(size_t id, heap_key_t key) {
+    keyed_dummy_t *kd = malloc(sizeof *kd);
+    kd->id = id;
+    kd->key = key;
+    return kd;
+}
+
+// order dummies of equal cached keys by their own key, then by their id
+static int compare_dummies(void *dummy1, void *dummy2) {
+    keyed_dummy_t *kd1 = dummy1, *kd2 = dummy2;
+    if (kd1->key != kd2->key)
+        return (kd1->key > kd2->key) - (kd1->key < kd2->key);
+    return (kd1->id > kd2->id) - (kd1->id < kd2->id);
+}
+
+// keep dummies with an even id, releasing the others
+static bool keep_even(void *dummy, void *data) {
+    keyed_dummy_t *kd = dummy;
+    if (kd->id % 2 == 0) return true;
+    free(kd);
+    return false;
+}
+
+// keep every dummy, moving its key earlier by a given shift
+static bool shift_key(void *dummy, void *shift) {
+    keyed_dummy_t *kd = dummy;
+    kd->key -= *(heap_key_t const *)shift;
+    return true;
+}
+
+int main(void) {
+    unsigned int seed = 42;
+    printf("====================\n");
+    radix_t *radix = radix_new_keyed(offsetof(keyed_dummy_t, key), &compare_dummies, &free);
+    keyed_dummy_t *kd;
+    size_t id = 0;
+
+    for (size_t i = 0; i < 50; i++)
+        radix_insert(radix, new_dummy(id++, rand_r(&seed)%50));
+
+    // extract, while inserting keys no lower than the last extracted key, of any magnitude
+    heap_key_t kk = 0;
+    size_t kid = 0;
+    for (size_t i = 0; i < 500; i++) {
+        kd = radix_extract_min(radix);
+        printf("extract <keyed dummy #%lu>\tkey=%lu\n", kd->id, (unsigned long)kd->key);
+        if (kd->key < kk) {
+            printf("ERROR: %lu < %lu!\n", (unsigned long)kd->key, (unsigned long)kk);
+            printf("====================\n");
+            return 1;
+        }
+        if (kd->key == kk && kd->id < kid) {
+            printf("ERROR: tie of key %lu broken with #%lu after #%lu!\n", (unsigned long)kk, kd->id, kid);
+            printf("====================\n");
+            return 1;
+        }
+        kk = kd->key;
+        kid = kd->id;
+        free(kd);
+        heap_key_t delta = (i%3==0) ? (heap_key_t)rand_r(&seed) << (rand_r(&seed)%32) : rand_r(&seed)%50;
+        radix_insert(radix, new_dummy(id++, kk+delta));
+        if (i%7==0)
+            radix_insert(radix, new_dummy(id++, kk+delta/2));
+    }
+
+    // filtered values are never extracted, the others are still in order
+    size_t size = radix_size(radix);
+    size_t removed = radix_filter(radix, &keep_even, NULL);
+    if (radix_size(radix) != size-removed) {
+        printf("ERROR: %lu values left instead of %lu!\n", radix_size(radix), size-removed);
+        printf("====================\n");
+        return 1;
+    }
+    for (size_t i = 0; i < 20; i++) {
+        kd = radix_extract_min(radix);
+        if (kd->key < kk || kd->id % 2 != 0) {
+            printf("ERROR: dummy #%lu with key %lu extracted after %lu!\n", kd->id, (unsigned long)kd->key, (unsigned long)kk);
+            printf("====================\n");
+            return 1;
+        }
+        kk = kd->key;
+        free(kd);
+    }
+
+    // keys moved earlier are read again, relatively to a new last extracted key
+    heap_key_t shift = kk/2;
+    radix_filter(radix, &shift_key, &shift);
+    kk -= shift;
+    radix_rekey(radix, kk);
+    for (size_t i = 0; i < 5; i++) {
+        kd = radix_extract_min(radix);
+        if (kd->key < kk) {
+            printf("ERROR: shifted dummy #%lu with key %lu extracted after %lu!\n", kd->id, (unsigned long)kd->key, (unsigned long)kk);
+            printf("====================\n");
+            return 1;
+        }
+        kk = kd->key;
+        free(kd);
+    }
+
+    // a key lower than the last extracted one is extracted next, even before equal keys
+    kd = radix_extract_min(radix);
+    kk = kd->key;
+    free(kd);
+    radix_insert(radix, new_dummy(id++, kk));
+    radix_insert(radix, new_dummy(id++, kk-1));
+    kd = radix_extract_min(radix);
+    printf("extract <keyed dummy #%lu>\tkey=%lu (late)\n", kd->id, (unsigned long)kd->key);
+    if (kd->id != id-1) {
+        printf("ERROR: late dummy not extracted first!\n");
+        printf("====================\n");
+        return 1;
+    }
+    free(kd);
+
+    // once empty, any key can be inserted again
+    size = radix_size(radix);
+    for (size_t i = 0; i < size; i++)
+        free(radix_extract_min(radix));
+    if (radix_extract_min(radix) != NULL) {
+        printf("ERROR: extracted from an empty heap!\n");
+        printf("====================\n");
+        return 1;
+    }
+    for (size_t i = 0; i < 10; i++)
+        radix_insert(radix, new_dummy(id++, 9-i));
+    for (heap_key_t k = 0; k < 5; k++) { // leave values for deallocation
+        kd = radix_extract_min(radix);
+        if (kd->key != k) {
+            printf("ERROR: %lu != %lu!\n", (unsigned long)kd->key, (unsigned long)k);
+            printf("====================\n");
+            return 1;
+        }
+        free(kd);
+    }
+    radix_deallocate(radix);
+
+    printf("OK!\n");
+
+    printf("====================\n");
+    return 0;
+}
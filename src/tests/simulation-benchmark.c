@@ -0,0 +1,216 @@
+#include "simulation.h"
+#include "snapshot.h"
+#include "chrono.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+static void usage(char const *name) {
+    fprintf(stderr, "Usage :\n");
+    fprintf(stderr, "\t%s [-w output-reference|-c input-reference] source-file|snapshot-file|number-of-generated-particles[@packing-fraction] duration [scheduler[:neighbors[:compaction-threshold[:domains[p]]]][/threads]...]\n", name);
+    fprintf(stderr, "\t-w : write the final positions of the first run, to compare another build with\n");
+    fprintf(stderr, "\t-c : compare every run with final positions written by `-w`, instead of the first run\n");
+    fprintf(stderr, "\tdomains are run by threads, or by worker processes if followed by `p`\n");
+    fprintf(stderr, "\tthreads share the predictions of a particle with many candidates\n");
+}
+
+// read options from "scheduler[:neighbors[:compaction-threshold[:domains[p]]]][/threads]"
+static bool parse_run(char const *run, simulation_options_t *options) {
+    char name[64], spec[256];
+    size_t len = strcspn(run, "/");
+    if (len >= sizeof spec) return false;
+    if (run[len] == '/') {
+        char *endptr;
+        options->nb_threads = strtoul(run+len+1, &endptr, 10);
+        if (endptr == run+len+1 || *endptr != '\0') return false;
+    }
+    memcpy(spec, run, len);
+    spec[len] = '\0';
+    run = spec;
+    len = strcspn(run, ":");
+    if (len >= sizeof name) return false;
+    memcpy(name, run, len);
+    name[len] = '\0';
+    if (!scheduler_type_parse(name, &options->scheduler)) return false;
+    if (run[len] == '\0') return true;
+    run += len+1;
+    len = strcspn(run, ":");
+    if (len >= sizeof name) return false;
+    memcpy(name, run, len);
+    name[len] = '\0';
+    if (!neighbors_type_parse(name, &options->neighbors)) return false;
+    if (run[len] == '\0') return true;
+    char *endptr;
+    options->compaction_threshold = strtod(run+len+1, &endptr);
+    if (*endptr == '\0') return true;
+    if (*endptr != ':') return false;
+    options->nb_domains = strtoul(endptr+1, &endptr, 10);
+    options->domain_processes = *endptr == 'p';
+    return *(endptr + options->domain_processes) == '\0';
+}
+
+// final positions of the reference run, in the widest precision so that builds can be compared
+typedef long double reference_t[NB_DIM];
+
+static void reference_set(reference_t *reference, particles_t const *run) {
+    for (size_t i = 0; i < run->count; i++)
+        for (size_t d = 0; d < NB_DIM; d++)
+            reference[i][d] = run->position[d][i];
+}
+
+static void reference_write(reference_t const *reference, size_t count, FILE *file) {
+    fprintf(file, "%lu\n", count);
+    for (size_t i = 0; i < count; i++)
+        for (size_t d = 0; d < NB_DIM; d++)
+            fprintf(file, "%.21Le%c", reference[i][d], (d+1<NB_DIM)?',':'\n');
+}
+
+static bool reference_read(reference_t *reference, size_t count, FILE *file) {
+    size_t file_count;
+    if (fscanf(file, "%lu", &file_count) != 1 || file_count != count) return false;
+    for (size_t i = 0; i < count; i++)
+        for (size_t d = 0; d < NB_DIM; d++)
+            if (fscanf(file, " %Le,", &reference[i][d]) != 1) return false;
+    return true;
+}
+
+// greatest distance between the reference positions and the positions of the same particles
+static long double divergence(reference_t const *reference, particles_t const *run) {
+    long double ans = 0;
+    for (size_t i = 0; i < run->count; i++) {
+        long double dist = 0;
+        for (size_t d = 0; d < NB_DIM; d++) {
+            long double delta = reference[i][d] - run->position[d][i];
+            dist += delta*delta;
+        }
+        dist = sqrtl(dist);
+        if (dist > ans) ans = dist;
+    }
+    return ans;
+}
+
+/* Compare the simulation options on the same input */
+int main(int argc, char const *argv[]) {
+    char const *write_path = NULL, *compare_path = NULL;
+    while (argc>1 && argv[1][0]=='-') { // options
+        if (argc<3 || (strcmp(argv[1], "-w")!=0 && strcmp(argv[1], "-c")!=0)) {
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        if (argv[1][1]=='w') write_path = argv[2];
+        else compare_path = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc<3) {
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    particles_t *particles = particles_new(0);
+    size_t count;
+    char *endptr;
+    count = strtol(argv[1], &endptr, 10);
+    if (endptr!=NULL && *endptr=='\0') { // number read
+        generate_particles(particles, count, 6502);
+    } else if (endptr!=argv[1] && *endptr=='@') { // number and packing fraction read
+        long double packing_fraction = strtold(endptr+1, &endptr);
+        if (*endptr!='\0') {
+            fprintf(stderr, "not a valid packing fraction: %s\n", argv[1]);
+            exit(EXIT_FAILURE);
+        }
+        packing_fraction = generate_packed_particles(particles, count, packing_fraction, 6502);
+        printf("packing fraction %Lg\n", packing_fraction);
+    } else if (snapshot_check(argv[1])) { // binary snapshot, mapped in memory
+        particles_deallocate(particles);
+        particles = snapshot_load(argv[1], NULL);
+        if (particles == NULL) {
+            fprintf(stderr, "Cannot read snapshot %s!\n", argv[1]);
+            exit(EXIT_FAILURE);
+        }
+        count = particles->count;
+    } else {
+        FILE *input_file = fopen(argv[1], "r");
+        if (input_file == NULL) {
+            fprintf(stderr, "Cannot read file %s!\n", argv[1]);
+            exit(EXIT_FAILURE);
+        }
+        load_error_t error;
+        count = load_particles(particles, input_file, &error);
+        fclose(input_file);
+        if (error.reason != NULL) {
+            reader_print_error(argv[1], &error, stderr);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    double duration = strtod(argv[2], &endptr);
+    if (endptr==NULL || *endptr!='\0') {
+        fprintf(stderr, "not a valid duration: %s\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+
+    char const *default_runs[] = {"heap:all", "tournament:all", "radix:all", "heap:grid", "tournament:grid", "radix:grid", "heap:sweep", "heap:hgrid"};
+    char const **runs = (argc>3) ? argv+3 : default_runs;
+    size_t nb_runs = (argc>3) ? (size_t)argc-3 : sizeof default_runs / sizeof *default_runs;
+
+    reference_t *reference = malloc(count * sizeof *reference);
+    bool has_reference = false;
+    if (compare_path != NULL) {
+        FILE *reference_file = fopen(compare_path, "r");
+        if (reference_file == NULL || !reference_read(reference, count, reference_file)) {
+            fprintf(stderr, "Cannot read reference %s!\n", compare_path);
+            exit(EXIT_FAILURE);
+        }
+        fclose(reference_file);
+        has_reference = true;
+    }
+
+    printf("%lu particles (%.1f MB), duration %g, %lu bytes per event, %lu bytes per coordinate\n",
+           count, particles_memory(count)/1048576.0, duration, (unsigned long)sizeof(event_t), (unsigned long)sizeof(loc_t));
+    printf("%-20s %12s %12s %12s %12s %12s %10s %10s %10s %11s %10s %10s %10s %12s %12s\n",
+           "run", "events", "invalid", "crossings", "max-pending", "allocations", "recycled", "pool(MB)", "queue(MB)",
+           "compactions", "freed(MB)", "startup(s)", "run(s)", "events/s", "divergence");
+    for (size_t r = 0; r < nb_runs; r++) {
+        simulation_stats_t stats;
+        simulation_options_t options = SIMULATION_DEFAULT_OPTIONS;
+        options.stats = &stats;
+        if (!parse_run(runs[r], &options)) {
+            fprintf(stderr, "not a valid run: %s\n", runs[r]);
+            exit(EXIT_FAILURE);
+        }
+
+        particles_t *run = particles_clone(particles);
+        double start = chrono_now();
+        simulation_loop(run, duration*time_UNIT, NULL, 0, &options);
+        double elapsed = chrono_now() - start;
+
+        if (!has_reference) {
+            reference_set(reference, run);
+            has_reference = true;
+            if (write_path != NULL) {
+                FILE *reference_file = fopen(write_path, "w");
+                if (reference_file == NULL) {
+                    fprintf(stderr, "Cannot write reference %s!\n", write_path);
+                    exit(EXIT_FAILURE);
+                }
+                reference_write(reference, count, reference_file);
+                fclose(reference_file);
+            }
+        }
+        elapsed -= stats.startup_time;
+        printf("%-20s %12lu %12lu %12lu %12lu %12lu %9.1f%% %10.2f %10.2f %11lu %10.2f %10.3f %10.3f %12.0f %12.3Le\n",
+               runs[r], stats.nb_events, stats.nb_invalid, stats.nb_crossings, stats.max_pending,
+               stats.pool.nb_allocations, 100.0*stats.pool.nb_recycled/stats.pool.nb_allocations,
+               stats.pool.memory/1048576.0, scheduler_memory(options.scheduler, count+1, stats.max_pending)/1048576.0,
+               stats.nb_compactions, stats.compacted_memory/1048576.0, stats.startup_time, elapsed, stats.nb_events/elapsed, divergence(reference, run)/loc_UNIT);
+        particles_deallocate(run);
+    }
+
+    free(reference);
+    particles_deallocate(particles);
+
+    return 0;
+}
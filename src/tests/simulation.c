@@ -0,0 +1,289 @@
+#define _POSIX_C_SOURCE 199506L
+#include "simulation.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+// greatest distance between the positions of the same particles in two stores
+static loc_t divergence(particles_t const *ps1, particles_t const *ps2) {
+    loc_t ans = 0;
+    for (size_t i = 0; i < ps1->count; i++) {
+        loc_t dist = 0;
+        for (size_t d = 0; d < NB_DIM; d++) {
+            loc_t delta = ps1->position[d][i] - ps2->position[d][i];
+            dist += delta*delta;
+        }
+        if (sqrtl(dist) > ans) ans = sqrtl(dist);
+    }
+    return ans;
+}
+
+// greatest overlap between two particles at a given time, relative to the sum of their radii
+static loc_t max_overlap(particles_t const *ps, time_t timestamp) {
+    loc_t ans = 0;
+    for (size_t i = 0; i < ps->count; i++)
+        for (size_t j = i+1; j < ps->count; j++) {
+            loc_t pi[NB_DIM], pj[NB_DIM];
+            particles_position_at(ps, i, timestamp, pi);
+            particles_position_at(ps, j, timestamp, pj);
+            loc_t overlap = 1 - loc_distance(pi, pj) / (ps->radius[i]+ps->radius[j]);
+            if (overlap > ans) ans = overlap;
+        }
+    return ans;
+}
+
+// a simulation advanced step by step must give the same result as a whole loop
+static void check_steps(simulation_options_t const *options, time_t duration) {
+    particles_t *whole = particles_new(0);
+    generate_particles(whole, 200, 42);
+    particles_t *steps = particles_clone(whole);
+    simulation_loop(whole, duration, NULL, 0, options);
+    simulation_t *sim = simulation_new(steps, (duration<0) ? -1 : 1, options);
+    for (int k = 1; k <= 7; k++)
+        simulation_advance_to(sim, duration*k/7);
+    simulation_advance_to(sim, duration/2); // already past
+    assert(simulation_time(sim) == duration);
+    simulation_destroy(sim);
+    printf("%15s:%-6s %+6.0f    %Le\n", scheduler_type_name(options->scheduler), neighbors_type_name(options->neighbors),
+           (double)(duration/time_UNIT), (long double)(divergence(whole, steps)/loc_UNIT));
+    assert(divergence(whole, steps) == 0);
+    for (size_t i = 0; i < whole->count; i++)
+        assert(steps->timestamp[i] == duration);
+    particles_deallocate(whole);
+    particles_deallocate(steps);
+}
+
+// moving the epoch shifts the pending events instead of predicting them again, which must keep the same result
+static void check_epochs(simulation_options_t options, time_t duration) {
+    simulation_stats_t stats;
+    particles_t *fixed = particles_new(0);
+    generate_particles(fixed, 200, 1515);
+    particles_t *moved = particles_clone(fixed);
+    options.epoch_period = 0;
+    simulation_loop(fixed, duration, NULL, 0, &options);
+    options.epoch_period = 16*time_UNIT;
+    options.stats = &stats;
+    simulation_loop(moved, duration, NULL, 0, &options);
+    printf("%15s:%-6s %+6.0f %6lu    %Le\n", scheduler_type_name(options.scheduler), neighbors_type_name(options.neighbors),
+           (double)(duration/time_UNIT), stats.nb_epochs, (long double)(divergence(fixed, moved)/loc_UNIT));
+    assert(stats.nb_epochs > 0);
+    assert(EQ_LOC_ZERO(divergence(fixed, moved)));
+    particles_deallocate(fixed);
+    particles_deallocate(moved);
+}
+
+// a simulation run forward then backward must come back to its initial state,
+// as does a simulation predicting every event again at reversal
+static void check_reversal(simulation_options_t const *options, time_t duration) {
+    particles_t *initial = particles_new(0);
+    generate_particles(initial, 200, 7);
+    particles_t *ps = particles_clone(initial), *rebuilt = particles_clone(initial);
+    simulation_t *sim = simulation_new(ps, 1, options);
+    simulation_advance_to(sim, duration);
+    simulation_reverse_time(sim);
+    simulation_advance_to(sim, 0);
+    simulation_destroy(sim);
+    simulation_loop(rebuilt, duration, NULL, 0, options);
+    for (size_t i = 0; i < rebuilt->count; i++) // snapshots are at `duration`
+        rebuilt->timestamp[i] = 0;
+    simulation_loop(rebuilt, -duration, NULL, 0, options);
+    printf("%15s:%-6s %6.0f    %Le    %Le\n", scheduler_type_name(options->scheduler), neighbors_type_name(options->neighbors),
+           (double)(duration/time_UNIT), (long double)(divergence(initial, ps)/loc_UNIT), (long double)(divergence(rebuilt, ps)/loc_UNIT));
+    assert(divergence(initial, ps) < 1e-9*loc_UNIT);
+    assert(divergence(rebuilt, ps) < 1e-9*loc_UNIT);
+    particles_deallocate(initial);
+    particles_deallocate(ps);
+    particles_deallocate(rebuilt);
+}
+
+// a simulation split into domains run in parallel must give the same result as the serial engine
+static void check_domains(simulation_options_t options, time_t duration) {
+    simulation_stats_t stats;
+    particles_t *serial = particles_new(0);
+    generate_particles(serial, 300, 1789);
+    particles_t *parallel = particles_clone(serial);
+    simulation_options_t serial_options = options;
+    serial_options.nb_domains = 0;
+    simulation_loop(serial, duration, NULL, 0, &serial_options);
+    options.stats = &stats;
+    simulation_loop(parallel, duration, NULL, 0, &options);
+    printf("%15s:%-6s %2lu%c %+6.0f %6lu %6lu    %Le\n", scheduler_type_name(options.scheduler), neighbors_type_name(options.neighbors),
+           options.nb_domains, options.domain_processes ? 'p' : ' ', (double)(duration/time_UNIT), stats.nb_windows, stats.nb_rollbacks,
+           (long double)(divergence(serial, parallel)/loc_UNIT));
+    assert(EQ_LOC_ZERO(divergence(serial, parallel)));
+    for (size_t i = 0; i < parallel->count; i++)
+        assert(parallel->timestamp[i] == duration);
+    particles_deallocate(serial);
+    particles_deallocate(parallel);
+}
+
+// particles added one by one to a running simulation, whose time is reversed, must never overlap
+static void check_additions(simulation_options_t options) {
+    simulation_stats_t stats;
+    options.stats = &stats;
+    particles_t *ps = particles_new(0);
+    particles_t *source = particles_new(0);
+    generate_particles(source, 150, 6502);
+    simulation_t *sim = simulation_new(ps, 1, &options);
+    time_t t = 0;
+    int time_flow = 1;
+    for (size_t k = 0; k < source->count; k++) {
+        particle_t p = particles_get(source, k);
+        loc_t position[NB_DIM];
+        bool overlap = false;
+        for (size_t j = 0; j < ps->count && !overlap; j++) {
+            particles_position_at(ps, j, t-simulation_epoch(sim), position);
+            overlap = loc_distance(p.position, position) < p.radius+ps->radius[j];
+        }
+        if (overlap) continue; // the place is taken at that time
+        p.timestamp = t;
+        assert(simulation_add_particle(sim, &p) == ps->count-1);
+        t += 100*time_flow*time_UNIT;
+        simulation_advance_to(sim, t);
+        assert(max_overlap(ps, t-simulation_epoch(sim)) < 1e-6);
+        if (k%3 == 2) {
+            simulation_reverse_time(sim);
+            time_flow *= -1;
+        }
+    }
+    simulation_destroy(sim);
+    assert(max_overlap(ps, t) < 1e-6);
+    printf("%15s:%-6s %6lu %8lu    %Le\n", scheduler_type_name(options.scheduler), neighbors_type_name(options.neighbors),
+           ps->count, stats.nb_events, (long double)max_overlap(ps, t));
+    particles_deallocate(ps);
+    particles_deallocate(source);
+}
+
+// particles without radius only meet walls, domains must not wait for them to move
+static void check_point_domains(simulation_options_t options) {
+    particles_t *serial = particles_new(0);
+    generate_particles(serial, 100, 1789);
+    for (size_t i = 0; i < serial->count; i++)
+        serial->radius[i] = 0;
+    particles_t *parallel = particles_clone(serial);
+    simulation_loop(serial, 300*time_UNIT, NULL, 0, &options);
+    options.nb_domains = 2;
+    simulation_loop(parallel, 300*time_UNIT, NULL, 0, &options);
+    assert(EQ_LOC_ZERO(divergence(serial, parallel)));
+    particles_deallocate(serial);
+    particles_deallocate(parallel);
+}
+
+// predictions shared between threads must give the same events as one thread
+static void check_threads(simulation_options_t options, time_t duration) {
+    simulation_stats_t serial_stats, threaded_stats;
+    particles_t *serial = particles_new(0);
+    generate_particles(serial, 300, 1789);
+    particles_t *threaded = particles_clone(serial);
+    options.stats = &serial_stats;
+    simulation_loop(serial, duration, NULL, 0, &options);
+    simulation_options_t serial_options = options;
+    options.nb_threads = 4;
+    options.parallel_candidates = 16;
+    options.stats = &threaded_stats;
+    simulation_loop(threaded, duration, NULL, 0, &options);
+    printf("%15s:%-6s %+6.0f %8lu    %Le\n", scheduler_type_name(options.scheduler), neighbors_type_name(options.neighbors),
+           (double)(duration/time_UNIT), threaded_stats.nb_events, (long double)(divergence(serial, threaded)/loc_UNIT));
+    assert(EQ_LOC_ZERO(divergence(serial, threaded)));
+    assert(threaded_stats.nb_events == serial_stats.nb_events);
+    // reversed simulations predict again from the last collision of each particle
+    int back = (duration<0) ? 1 : -1;
+    simulation_t *sims[2] = {simulation_new(serial, back, &serial_options), simulation_new(threaded, back, &options)};
+    for (size_t k = 0; k < 2; k++) {
+        simulation_advance_to(sims[k], duration/2);
+        simulation_reverse_time(sims[k]);
+        simulation_advance_to(sims[k], duration);
+        simulation_destroy(sims[k]);
+    }
+    assert(EQ_LOC_ZERO(divergence(serial, threaded)));
+    particles_deallocate(serial);
+    particles_deallocate(threaded);
+}
+
+int
+main(void)
+{
+    enum scheduler_type schedulers[] = {SCHEDULER_HEAP, SCHEDULER_TOURNAMENT, SCHEDULER_RADIX};
+    enum neighbors_type neighbors[] = {NEIGHBORS_ALL, NEIGHBORS_GRID, NEIGHBORS_SWEEP, NEIGHBORS_HGRID};
+    simulation_options_t options = SIMULATION_DEFAULT_OPTIONS;
+    printf("====================\n");
+    printf("testing simulations advanced step by step...\n");
+    for (size_t s = 0; s < sizeof schedulers / sizeof *schedulers; s++)
+        for (size_t n = 0; n < sizeof neighbors / sizeof *neighbors; n++) {
+            options.scheduler = schedulers[s];
+            options.neighbors = neighbors[n];
+            check_steps(&options,  300*time_UNIT);
+            check_steps(&options, -300*time_UNIT);
+        }
+    printf("OK!\n");
+    printf("====================\n");
+    printf("testing simulations moving their epoch...\n");
+    for (size_t s = 0; s < sizeof schedulers / sizeof *schedulers; s++)
+        for (size_t n = 0; n < sizeof neighbors / sizeof *neighbors; n++) {
+            options.scheduler = schedulers[s];
+            options.neighbors = neighbors[n];
+            check_epochs(options,  300*time_UNIT);
+            check_epochs(options, -300*time_UNIT);
+        }
+    printf("OK!\n");
+    printf("====================\n");
+    printf("testing simulations run forward then backward...\n");
+    for (size_t s = 0; s < sizeof schedulers / sizeof *schedulers; s++)
+        for (size_t n = 0; n < sizeof neighbors / sizeof *neighbors; n++) {
+            options.scheduler = schedulers[s];
+            options.neighbors = neighbors[n];
+            check_reversal(&options, 200*time_UNIT);
+        }
+    printf("OK!\n");
+    printf("====================\n");
+    printf("testing predictions shared between threads...\n");
+    for (size_t s = 0; s < sizeof schedulers / sizeof *schedulers; s++)
+        for (size_t n = 0; n < sizeof neighbors / sizeof *neighbors; n++) {
+            options.scheduler = schedulers[s];
+            options.neighbors = neighbors[n];
+            check_threads(options,  300*time_UNIT);
+            check_threads(options, -300*time_UNIT);
+        }
+    printf("OK!\n");
+    printf("====================\n");
+    printf("testing simulations split into domains...\n");
+    for (size_t s = 0; s < sizeof schedulers / sizeof *schedulers; s++)
+        for (size_t n = 0; n < sizeof neighbors / sizeof *neighbors; n++) {
+            options.scheduler = schedulers[s];
+            options.neighbors = neighbors[n];
+            for (size_t nb_domains = 2; nb_domains <= 8; nb_domains *= 2) {
+                options.nb_domains = nb_domains;
+                check_domains(options,  300*time_UNIT);
+                check_domains(options, -300*time_UNIT);
+            }
+        }
+    options.domain_processes = true; // the same windows, run by worker processes
+    for (size_t n = 0; n < sizeof neighbors / sizeof *neighbors; n++) {
+        options.scheduler = schedulers[0];
+        options.neighbors = neighbors[n];
+        for (size_t nb_domains = 2; nb_domains <= 8; nb_domains *= 2) {
+            options.nb_domains = nb_domains;
+            check_domains(options,  300*time_UNIT);
+            check_domains(options, -300*time_UNIT);
+        }
+    }
+    options.nb_domains = 0;
+    options.domain_processes = false;
+    check_point_domains(options);
+    printf("OK!\n");
+    printf("====================\n");
+    printf("testing particles added to running simulations...\n");
+    for (size_t s = 0; s < sizeof schedulers / sizeof *schedulers; s++)
+        for (size_t n = 0; n < sizeof neighbors / sizeof *neighbors; n++) {
+            options.scheduler = schedulers[s];
+            options.neighbors = neighbors[n];
+            check_additions(options);
+        }
+    printf("OK!\n");
+    printf("====================\n");
+    printf("TEST OK!\n");
+    printf("====================\n");
+    return 0;
+}
@@ -0,0 +1,122 @@
+#define _GNU_SOURCE
+#include "tournament.h"
+#include "dummy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stddef.h>
+
+#define NB_LEAVES 50
+
+/** @brief A dummy structure ordered by an embedded key. */
+typedef struct {
+    size_t     id;
+    heap_key_t key;
+} keyed_dummy_t;
+
+// order dummies of equal keys by their id
+static int compare_ids(void *dummy1, void *dummy2) {
+    keyed_dummy_t *kd1 = dummy1, *kd2 = dummy2;
+    return (kd1->id > kd2->id) - (kd1->id < kd2->id);
+}
+
+static void dealloc_dummy(void *dummy) {
+    dummy_t *d = dummy;
+    free(d->value);
+    free(d);
+}
+
+static dummy_t *new_dummy(unsigned int *seed, size_t leaf) {
+    dummy_t *d = malloc(sizeof *d);
+    d->key = rand_r(seed)*50.0/RAND_MAX;
+    if (asprintf(&(d->value), "dummy of leaf #%lu", leaf)<0) exit(1);
+    return d;
+}
+
+// keep dummies with a key lower than 40, reversing the order of their keys, and release the others
+static bool keep_reversed(void *dummy, void *data) {
+    dummy_t *d = dummy;
+    if (d->key >= 40) {
+        dealloc_dummy(d);
+        return false;
+    }
+    d->key = 50 - d->key;
+    return true;
+}
+
+int main(void) {
+    unsigned int seed = 42;
+    printf("====================\n");
+    tournament_t *dummy_tree = tournament_new(NB_LEAVES, &compare_dummies, &dealloc_dummy);
+    dummy_t *d;
+    size_t leaf;
+
+    for (size_t i = 0; i < NB_LEAVES; i++) // fill every leaf
+        tournament_set(dummy_tree, i, new_dummy(&seed, i));
+
+    for (size_t i = 0; i < 3*NB_LEAVES; i++) { // replace random leaves
+        leaf = rand_r(&seed)%NB_LEAVES;
+        d = tournament_set(dummy_tree, leaf, (i%5==0) ? NULL : new_dummy(&seed, leaf));
+        if (d != NULL) dealloc_dummy(d);
+    }
+
+    // the filter changes the order, so every match is replayed
+    tournament_filter(dummy_tree, &keep_reversed, NULL);
+
+    double k = -INFINITY;
+    size_t count = 0;
+    while ((d=tournament_extract_min(dummy_tree, &leaf)) != NULL) {
+        printf("extract <%s>\tkey=%lf\n", d->value, d->key);
+        if (d->key < k || d->key <= 10) {
+            printf("ERROR: %f < %f!\n", d->key, k);
+            printf("====================\n");
+            return 1;
+        }
+        if (tournament_get(dummy_tree, leaf) != NULL) {
+            printf("ERROR: leaf #%lu not emptied!\n", leaf);
+            printf("====================\n");
+            return 1;
+        }
+        k = d->key;
+        count++;
+        dealloc_dummy(d);
+    }
+    if (count > NB_LEAVES) {
+        printf("ERROR: %lu values extracted from %d leaves!\n", count, NB_LEAVES);
+        printf("====================\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < NB_LEAVES; i+=2) // leave values for deallocation
+        tournament_set(dummy_tree, i, new_dummy(&seed, i));
+    tournament_deallocate(dummy_tree);
+
+    // ties between equal keys are broken by the comparator, not by the leaves
+    tournament_t *keyed_tree = tournament_new_keyed(NB_LEAVES, offsetof(keyed_dummy_t, key), &compare_ids, &free);
+    for (size_t i = 0; i < NB_LEAVES; i++) {
+        keyed_dummy_t *kd = malloc(sizeof *kd);
+        kd->id = NB_LEAVES-1-i;
+        kd->key = rand_r(&seed)%5;
+        tournament_set(keyed_tree, i, kd);
+    }
+    keyed_dummy_t *kd;
+    heap_key_t kk = 0;
+    size_t kid = 0;
+    while ((kd=tournament_extract_min(keyed_tree, &leaf)) != NULL) {
+        printf("extract <keyed dummy #%lu>\tkey=%lu\n", kd->id, (unsigned long)kd->key);
+        if (kd->key < kk || (kd->key == kk && kd->id < kid)) {
+            printf("ERROR: #%lu with key %lu extracted after #%lu with key %lu!\n", kd->id, (unsigned long)kd->key, kid, (unsigned long)kk);
+            printf("====================\n");
+            return 1;
+        }
+        kk = kd->key;
+        kid = kd->id;
+        free(kd);
+    }
+    tournament_deallocate(keyed_tree);
+
+    printf("OK!\n");
+
+    printf("====================\n");
+    return 0;
+}
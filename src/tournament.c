@@ -0,0 +1,125 @@
+#include "tournament.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct tournament {
+    /** The values of the leaves. Empty leaves are `NULL` */
+    void         **leaves;
+    /** The keys of the leaves, `NULL` if the tree uses a comparator */
+    heap_key_t    *keys;
+    /** The number of leaves */
+    size_t         nb_leaves;
+    /** The winners of the matches, stored as an implicit complete tree:
+     *  children of node `i` are nodes `2i` and `2i+1`, root is node `1`,
+     *  and leaf `k` would be node `width+k` */
+    size_t        *winners;
+    /** The number of leaves of the complete tree (a power of two) */
+    size_t         width;
+    /** The comparator function used by the elements, `NULL` for a keyed tree */
+    compare_func_t comparator;
+    /** The offset of the key inside the values of a keyed tree */
+    size_t         key_offset;
+    /** The comparator breaking ties between equal keys of a keyed tree, may be `NULL` */
+    compare_func_t tie;
+    /** The operator function used at deallocation */
+    operate_func_t deallocate_value;
+};
+
+
+
+// leaf number of the winner between two leaves (empty leaves always lose)
+static size_t match(tournament_t const *p_tree, size_t l1, size_t l2) {
+    void *v1 = (l1 < p_tree->nb_leaves) ? p_tree->leaves[l1] : NULL;
+    void *v2 = (l2 < p_tree->nb_leaves) ? p_tree->leaves[l2] : NULL;
+    if (v2 == NULL) return l1;
+    if (v1 == NULL) return l2;
+    if (p_tree->comparator == NULL) {
+        heap_key_t k1 = p_tree->keys[l1], k2 = p_tree->keys[l2];
+        if (k1 != k2 || p_tree->tie == NULL)
+            return (k2 < k1) ? l2 : l1;
+        return ((*p_tree->tie)(v2, v1) < 0) ? l2 : l1;
+    }
+    return ((*p_tree->comparator)(v2, v1) < 0) ? l2 : l1;
+}
+
+// winner of the subtree rooted at node
+static size_t winner(tournament_t const *p_tree, size_t node) {
+    return (node >= p_tree->width) ? node - p_tree->width : p_tree->winners[node];
+}
+
+// replay the matches from a leaf up to the root
+static void replay(tournament_t *p_tree, size_t leaf) {
+    for (size_t node = (p_tree->width+leaf)>>1; node > 0; node >>= 1)
+        p_tree->winners[node] = match(p_tree, winner(p_tree, node<<1), winner(p_tree, (node<<1)+1));
+}
+
+// create a tree with empty leaves, keyed if comparator is NULL
+static tournament_t *tournament_alloc(size_t nb_leaves, compare_func_t comparator, size_t key_offset, compare_func_t tie, operate_func_t deallocate_value) {
+    tournament_t *ans = malloc(sizeof *ans);
+    size_t width = 1;
+    while (width < nb_leaves)
+        width <<= 1;
+    *ans = (tournament_t){calloc(nb_leaves, sizeof *ans->leaves),
+                          (comparator==NULL) ? malloc(nb_leaves * sizeof *ans->keys) : NULL, nb_leaves,
+                          malloc(width * sizeof *ans->winners), width,
+                          comparator, key_offset, tie, deallocate_value};
+    for (size_t node = width-1; node > 0; node--) // every leaf is empty
+        ans->winners[node] = winner(ans, node<<1);
+    return ans;
+}
+
+// functions from the signature
+tournament_t *tournament_new(size_t nb_leaves, compare_func_t comparator, operate_func_t deallocate_value) {
+    return tournament_alloc(nb_leaves, comparator, 0, NULL, deallocate_value);
+}
+
+tournament_t *tournament_new_keyed(size_t nb_leaves, size_t key_offset, compare_func_t tie, operate_func_t deallocate_value) {
+    return tournament_alloc(nb_leaves, NULL, key_offset, tie, deallocate_value);
+}
+
+void *tournament_get(tournament_t const *p_tree, size_t leaf) {
+    return p_tree->leaves[leaf];
+}
+
+void *tournament_set(tournament_t *p_tree, size_t leaf, void *value) {
+    void *ans = p_tree->leaves[leaf];
+    p_tree->leaves[leaf] = value;
+    if (p_tree->comparator == NULL && value != NULL)
+        memcpy(&p_tree->keys[leaf], (char const *)value + p_tree->key_offset, sizeof *p_tree->keys);
+    replay(p_tree, leaf);
+    return ans;
+}
+
+void *tournament_extract_min(tournament_t *p_tree, size_t *leaf) {
+    size_t min = winner(p_tree, 1);
+    if (min >= p_tree->nb_leaves || p_tree->leaves[min] == NULL) return NULL;
+    if (leaf != NULL) *leaf = min;
+    return tournament_set(p_tree, min, NULL);
+}
+
+size_t tournament_filter(tournament_t *p_tree, filter_func_t keep, void *data) {
+    size_t removed = 0;
+    for (size_t i = 0; i < p_tree->nb_leaves; i++) {
+        void *value = p_tree->leaves[i];
+        if (value == NULL) continue;
+        if (!(*keep)(value, data)) {
+            p_tree->leaves[i] = NULL;
+            removed++;
+        } else if (p_tree->comparator == NULL) // keep may have changed it
+            memcpy(&p_tree->keys[i], (char const *)value + p_tree->key_offset, sizeof *p_tree->keys);
+    }
+    for (size_t node = p_tree->width-1; node > 0; node--) // replay bottom-up
+        p_tree->winners[node] = match(p_tree, winner(p_tree, node<<1), winner(p_tree, (node<<1)+1));
+    return removed;
+}
+
+void tournament_deallocate(tournament_t *p_tree) {
+    if (p_tree->deallocate_value!=NULL)
+        for (size_t i = 0; i < p_tree->nb_leaves; i++)
+            if (p_tree->leaves[i] != NULL)
+                (*p_tree->deallocate_value)(p_tree->leaves[i]);
+    free(p_tree->leaves);
+    free(p_tree->keys);
+    free(p_tree->winners);
+    free(p_tree);
+}